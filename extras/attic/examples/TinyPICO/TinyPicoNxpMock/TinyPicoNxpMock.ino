@@ -35,7 +35,7 @@ hf::MockReceiver rc;
 
 hf::MixerQuadXCF mixer;
 
-hf::NxpSoftwareQuaternionIMU imu;
+hf::NxpSoftwareQuaternionIMU<> imu;
 
 hf::MockMotor motor1;
 hf::MockMotor motor2;
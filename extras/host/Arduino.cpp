@@ -0,0 +1,166 @@
+/*
+   Just enough of the Arduino API to build Hackflight on a host computer
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+
+#include "Arduino.h"
+
+// Time skipped by delay()
+static uint64_t _delayUsec;
+
+// Handlers from attachInterrupt(), by interrupt number
+static void (*_interruptHandlers[256])(void);
+
+// One virtual clock per thread, so that independent simulations can run in parallel
+static thread_local bool _virtualClock;
+static thread_local uint64_t _virtualUsec;
+
+// Local static, so that it is set on first use even from other files' static initializers
+static std::chrono::steady_clock::time_point start(void)
+{
+    static const std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+
+    return _start;
+}
+
+uint32_t micros(void)
+{
+    if (_virtualClock) {
+        return (uint32_t)_virtualUsec;
+    }
+
+    std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start();
+
+    return (uint32_t)(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() + _delayUsec);
+}
+
+uint32_t millis(void)
+{
+    return micros() / 1000;
+}
+
+void delay(uint32_t msec)
+{
+    delayMicroseconds(1000 * msec);
+}
+
+void delayMicroseconds(uint32_t usec)
+{
+    if (_virtualClock) {
+        _virtualUsec += usec;
+    }
+    else {
+        _delayUsec += usec;
+    }
+}
+
+void hostUseVirtualClock(uint32_t startUsec)
+{
+    _virtualClock = true;
+    _virtualUsec = startUsec;
+}
+
+void hostAdvanceClock(uint32_t usec)
+{
+    _virtualUsec += usec;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    (void)pin;
+    (void)value;
+}
+
+uint8_t digitalPinToInterrupt(uint8_t pin)
+{
+    return pin;
+}
+
+void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode)
+{
+    (void)mode;
+
+    _interruptHandlers[interrupt] = isr;
+}
+
+void hostRaiseInterrupt(uint8_t interrupt)
+{
+    if (_interruptHandlers[interrupt]) {
+        _interruptHandlers[interrupt]();
+    }
+}
+
+HardwareSerial::HardwareSerial(FILE * output)
+{
+    _output = output;
+}
+
+void HardwareSerial::begin(uint32_t baud)
+{
+    (void)baud;
+}
+
+int HardwareSerial::available(void)
+{
+    return (uint16_t)(_inputHead - _inputTail);
+}
+
+int HardwareSerial::read(void)
+{
+    if (_inputHead == _inputTail) {
+        return -1;
+    }
+
+    return _input[_inputTail++ % INPUT_SIZE];
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    if (_output) {
+        fputc(c, _output);
+    }
+
+    return 1;
+}
+
+size_t HardwareSerial::print(const char * s)
+{
+    if (_output) {
+        fputs(s, _output);
+    }
+
+    return strlen(s);
+}
+
+void HardwareSerial::inject(const uint8_t * bytes, uint16_t count)
+{
+    for (uint16_t k=0; k<count && available()<INPUT_SIZE; ++k) {
+        _input[_inputHead++ % INPUT_SIZE] = bytes[k];
+    }
+}
+
+HardwareSerial Serial(stdout);
+HardwareSerial Serial1(NULL);
@@ -0,0 +1,100 @@
+/*
+   Just enough of the Arduino API to build Hackflight on a host computer
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define LOW     0
+#define HIGH    1
+
+#define INPUT   0
+#define OUTPUT  1
+
+#define FALLING 2
+
+// As every Arduino core defines them, so that the host build catches names that collide with them
+#define PI      3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI  6.283185307179586476925286766559
+
+// Time since startup.  delay() skips the clock ahead instead of sleeping, so startup LED flashing
+// and the like take no real time.
+uint32_t micros(void);
+uint32_t millis(void);
+void delay(uint32_t msec);
+void delayMicroseconds(uint32_t usec);
+
+// Pins are ignored; interrupt handlers are kept, to be raised by hostRaiseInterrupt()
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+uint8_t digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode);
+
+class HardwareSerial {
+
+    private:
+
+        static const uint16_t INPUT_SIZE = 256;
+
+        FILE * _output = NULL;
+
+        uint8_t  _input[INPUT_SIZE] = {};
+        uint16_t _inputHead = 0;
+        uint16_t _inputTail = 0;
+
+    public:
+
+        // Output goes to the given stream, or nowhere if NULL
+        HardwareSerial(FILE * output);
+
+        void begin(uint32_t baud);
+
+        int available(void);
+
+        int read(void);
+
+        size_t write(uint8_t c);
+
+        size_t print(const char * s);
+
+        // Host side: queues bytes to be read as if they had arrived over the wire
+        void inject(const uint8_t * bytes, uint16_t count);
+
+}; // class HardwareSerial
+
+extern HardwareSerial Serial;   // stdout
+extern HardwareSerial Serial1;  // discarded
+
+// Host extensions ---------------------------------------------------------------------------
+
+// Switches micros(), millis(), and delay() to a virtual clock that moves only when advanced,
+// so a simulation can run faster than real time and still make the same timing decisions.  The
+// virtual clock belongs to the calling thread.
+void hostUseVirtualClock(uint32_t startUsec=0);
+
+void hostAdvanceClock(uint32_t usec);
+
+// Calls the handler attached to an interrupt, if any, as though its pin had changed
+void hostRaiseInterrupt(uint8_t interrupt);
@@ -0,0 +1,157 @@
+/*
+   Accuracy and throughput of the kernels in fastmath.hpp against the C
+   library: worst error against a double-precision reference over random
+   arguments spanning each function's domain, and time per call for the
+   kernel and for the single-precision library function it replaces.
+
+   Usage: hackflight_bench_fastmath [REPETITIONS]
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "fastmath.hpp"
+
+static constexpr uint32_t COUNT = 1000000;
+
+static volatile float sink;
+
+typedef struct {
+
+    float a;
+    float b;
+
+} args_t;
+
+template <typename F>
+static double timeCalls(const std::vector<args_t> & args, uint32_t reps, F f)
+{
+    double best = INFINITY;
+
+    for (uint32_t r=0; r<reps; ++r) {
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        float sum = 0;
+        for (const args_t & x : args) {
+            sum += f(x);
+        }
+        sink = sum;
+
+        double nsec = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        best = nsec < best ? nsec : best;
+    }
+
+    return best / args.size();
+}
+
+// Worst absolute error, and worst error relative to the reference, against a double-precision reference
+template <typename F, typename R>
+static void measure(const std::vector<args_t> & args, F f, R ref, double & maxAbs, double & maxRel)
+{
+    maxAbs = 0;
+    maxRel = 0;
+
+    for (const args_t & x : args) {
+        double expected = ref(x);
+        double e = fabs(f(x) - expected);
+        maxAbs = e > maxAbs ? e : maxAbs;
+        if (expected != 0) {
+            double r = e / fabs(expected);
+            maxRel = r > maxRel ? r : maxRel;
+        }
+    }
+}
+
+template <typename F, typename L, typename R>
+static void report(const char * name, const std::vector<args_t> & args, uint32_t reps, F approx, L libm, R ref)
+{
+    double approxNsec = timeCalls(args, reps, approx);
+    double libmNsec = timeCalls(args, reps, libm);
+
+    double approxAbs = 0, approxRel = 0, libmAbs = 0, libmRel = 0;
+    measure(args, approx, ref, approxAbs, approxRel);
+    measure(args, libm, ref, libmAbs, libmRel);
+
+    printf("%-13s %6.2f ns  %8.2e abs %8.2e rel   | %-7s %6.2f ns  %8.2e abs %8.2e rel   | %4.2fx\n",
+            name, approxNsec, approxAbs, approxRel, "libm", libmNsec, libmAbs, libmRel, libmNsec / approxNsec);
+}
+
+static std::vector<args_t> makeArgs(std::mt19937 & rng, float lo, float hi, float lo2=0, float hi2=0)
+{
+    std::uniform_real_distribution<float> a(lo, hi), b(lo2, hi2);
+
+    std::vector<args_t> args(COUNT);
+
+    for (args_t & x : args) {
+        x.a = a(rng);
+        x.b = b(rng);
+    }
+
+    return args;
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t reps = argc > 1 ? atoi(argv[1]) : 10;
+
+    std::mt19937 rng(0);
+
+    printf("%u calls per kernel, best of %u repetitions; HACKFLIGHT_FAST_MATH is %s in this build\n\n",
+            COUNT, reps, hf::FastMath::ENABLED ? "on" : "off");
+
+    std::vector<args_t> args = makeArgs(rng, -1, +1, -1, +1);
+    report("atan2", args, reps,
+            [](const args_t & x) { return hf::FastMath::approxAtan2(x.a, x.b); },
+            [](const args_t & x) { return atan2f(x.a, x.b); },
+            [](const args_t & x) { return atan2((double)x.a, (double)x.b); });
+
+    args = makeArgs(rng, -1, +1);
+    report("asin", args, reps,
+            [](const args_t & x) { return hf::FastMath::approxAsin(x.a); },
+            [](const args_t & x) { return asinf(x.a); },
+            [](const args_t & x) { return asin((double)x.a); });
+
+    // Headless mode passes yaw in [0, 2 pi]; we check a wider range for the reduction
+    args = makeArgs(rng, -4 * M_PI, +4 * M_PI);
+    report("sincos (sin)", args, reps,
+            [](const args_t & x) { float s = 0, c = 0; hf::FastMath::approxSincos(x.a, s, c); return s; },
+            [](const args_t & x) { return sinf(x.a); },
+            [](const args_t & x) { return sin((double)x.a); });
+    report("sincos (cos)", args, reps,
+            [](const args_t & x) { float s = 0, c = 0; hf::FastMath::approxSincos(x.a, s, c); return c; },
+            [](const args_t & x) { return cosf(x.a); },
+            [](const args_t & x) { return cos((double)x.a); });
+    report("sincos (both)", args, reps,
+            [](const args_t & x) { float s = 0, c = 0; hf::FastMath::approxSincos(x.a, s, c); return s + c; },
+            [](const args_t & x) { return sinf(x.a) + cosf(x.a); },
+            [](const args_t & x) { return sin((double)x.a) + cos((double)x.a); });
+
+    // Squared norms of unit-ish vectors, and a wide range besides
+    args = makeArgs(rng, 1e-3f, 1e3f);
+    report("rsqrt", args, reps,
+            [](const args_t & x) { return hf::FastMath::approxRsqrt(x.a); },
+            [](const args_t & x) { return 1.0f / sqrtf(x.a); },
+            [](const args_t & x) { return 1 / sqrt((double)x.a); });
+
+    return 0;
+}
@@ -0,0 +1,576 @@
+/*
+   Microbenchmarks for the attitude estimators and filters in filters.hpp and
+   iirfilters.hpp
+
+   Each estimator runs on one minute of synthetic motion sampled at the gyro
+   rate, and is scored against a double-precision reference attitude.
+
+   Usage: hackflight_bench_filters [REPETITIONS]
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "filters.hpp"
+#include "iirfilters.hpp"
+#include "datatypes.hpp"
+#include "sensors/surfacemount/quaternion.hpp"
+
+static constexpr double GYRO_HZ     = 834;  // gyro rate on our boards
+static constexpr double SECONDS     = 60;
+static constexpr double GYRO_NOISE  = 0.01; // rad/s
+static constexpr double ACCEL_NOISE = 0.02; // g
+static constexpr double MAG_NOISE   = 0.02; // normalized field
+
+static constexpr float BETA = 0.1f;
+static constexpr float ZETA = 0.0f;
+
+// One gyro period's worth of sensor data, plus the true attitude (body to earth) afterwards
+typedef struct {
+
+    float g[3];
+    float a[3];
+    float m[3];
+
+    double q[4];
+
+} sample_t;
+
+static void quatMultiply(const double p[4], const double q[4], double r[4])
+{
+    r[0] = p[0]*q[0] - p[1]*q[1] - p[2]*q[2] - p[3]*q[3];
+    r[1] = p[0]*q[1] + p[1]*q[0] + p[2]*q[3] - p[3]*q[2];
+    r[2] = p[0]*q[2] - p[1]*q[3] + p[2]*q[0] + p[3]*q[1];
+    r[3] = p[0]*q[3] + p[1]*q[2] - p[2]*q[1] + p[3]*q[0];
+}
+
+// Rotates an earth-frame vector into the body frame: q* v q
+static void earthToBody(const double q[4], const double v[3], float b[3])
+{
+    double w = q[0], x = q[1], y = q[2], z = q[3];
+
+    b[0] = (float)((1-2*(y*y+z*z))*v[0] + 2*(x*y+w*z)*v[1]     + 2*(x*z-w*y)*v[2]);
+    b[1] = (float)(2*(x*y-w*z)*v[0]     + (1-2*(x*x+z*z))*v[1] + 2*(y*z+w*x)*v[2]);
+    b[2] = (float)(2*(x*z+w*y)*v[0]     + 2*(y*z-w*x)*v[1]     + (1-2*(x*x+y*y))*v[2]);
+}
+
+// Angle in degrees between two attitudes
+static double errorDegrees(const double q[4], float w, float x, float y, float z)
+{
+    double n = sqrt(w*w + x*x + y*y + z*z);
+    double d = fabs(q[0]*w + q[1]*x + q[2]*y + q[3]*z) / n;
+
+    return 2 * acos(d > 1 ? 1 : d) * 180 / M_PI;
+}
+
+// Smooth, sustained rotation on all three axes, like aggressive manual flight
+static std::vector<sample_t> makeMotion(void)
+{
+    std::mt19937 rng(0);
+    std::normal_distribution<double> normal(0, 1);
+
+    const double dt = 1 / GYRO_HZ;
+    const uint32_t count = (uint32_t)(SECONDS * GYRO_HZ);
+
+    // Reference is integrated in finer substeps than the filters get
+    const uint8_t SUBSTEPS = 10;
+
+    const double gravity[3] = {0, 0, 1};
+    const double field[3] = {0.5, 0, 0.866};  // 60 degree inclination
+
+    std::vector<sample_t> samples(count);
+
+    double q[4] = {1, 0, 0, 0};
+
+    for (uint32_t k=0; k<count; ++k) {
+
+        double t = k * dt;
+
+        double w[3] = { 2.0 * sin(0.7*t), 1.5 * sin(1.1*t + 1), 1.0 * sin(0.3*t + 2) };
+
+        for (uint8_t j=0; j<SUBSTEPS; ++j) {
+            double h = dt / SUBSTEPS;
+            double angle = sqrt(w[0]*w[0] + w[1]*w[1] + w[2]*w[2]) * h;
+            double s = angle > 0 ? sin(angle/2) / (angle/h) : 0;
+            double dq[4] = {cos(angle/2), w[0]*s, w[1]*s, w[2]*s};
+            double r[4];
+            quatMultiply(q, dq, r);
+            double n = sqrt(r[0]*r[0] + r[1]*r[1] + r[2]*r[2] + r[3]*r[3]);
+            for (uint8_t i=0; i<4; ++i) {
+                q[i] = r[i] / n;
+            }
+        }
+
+        sample_t & s = samples[k];
+
+        for (uint8_t i=0; i<3; ++i) {
+            s.g[i] = (float)(w[i] + GYRO_NOISE * normal(rng));
+        }
+
+        earthToBody(q, gravity, s.a);
+        earthToBody(q, field, s.m);
+
+        for (uint8_t i=0; i<3; ++i) {
+            s.a[i] += (float)(ACCEL_NOISE * normal(rng));
+            s.m[i] += (float)(MAG_NOISE * normal(rng));
+        }
+
+        for (uint8_t i=0; i<4; ++i) {
+            s.q[i] = q[i];
+        }
+    }
+
+    return samples;
+}
+
+// Keeps the optimizer from discarding the work
+static volatile float sink;
+
+static void report(const char * name, double nsec, double rmsError, double maxError, const char * units)
+{
+    printf("%-32s %8.1f ns/update %12.0f updates/s %6.3f%% of 834 Hz budget   error rms %8.4f max %8.4f %s\n",
+            name, nsec, 1e9/nsec, 100 * nsec * GYRO_HZ / 1e9, rmsError, maxError, units);
+}
+
+template <typename F>
+static double timeUpdates(uint32_t reps, uint32_t count, F update)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (uint32_t r=0; r<reps; ++r) {
+        update();
+    }
+
+    double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    return elapsed / ((double)reps * count);
+}
+
+template <typename Filter>
+static void benchQuaternionFilter(const char * name, const std::vector<sample_t> & samples, uint32_t reps,
+        Filter (*make)(void), void (*update)(Filter &, const sample_t &, float))
+{
+    const float dt = (float)(1 / GYRO_HZ);
+    const uint32_t count = samples.size();
+
+    // Accuracy, from one pass starting at the true initial attitude
+    Filter filter = make();
+    double sumsq = 0, maxError = 0;
+    for (uint32_t k=0; k<count; ++k) {
+        update(filter, samples[k], dt);
+        double e = errorDegrees(samples[k].q, filter.q1, filter.q2, filter.q3, filter.q4);
+        sumsq += e * e;
+        maxError = e > maxError ? e : maxError;
+    }
+
+    // Speed, over repeated passes
+    double nsec = timeUpdates(reps, count, [&]() {
+            Filter f = make();
+            for (uint32_t k=0; k<count; ++k) {
+                update(f, samples[k], dt);
+            }
+            sink = f.q1;
+        });
+
+    report(name, nsec, sqrt(sumsq/count), maxError, "deg");
+}
+
+static hf::MadgwickQuaternionFilter6DOF makeMadgwick6(void)
+{
+    return hf::MadgwickQuaternionFilter6DOF(BETA, ZETA);
+}
+
+static void updateMadgwick6(hf::MadgwickQuaternionFilter6DOF & f, const sample_t & s, float dt)
+{
+    f.update(s.a[0], s.a[1], s.a[2], s.g[0], s.g[1], s.g[2], dt);
+}
+
+// Batch updates a second's worth of samples at a time, scored against update() on one sample at a time
+static void benchMadgwick6Block(const std::vector<sample_t> & samples, uint32_t reps)
+{
+    const uint32_t count = samples.size();
+    const uint32_t blockSize = (uint32_t)GYRO_HZ;
+
+    std::vector<float> ax(count), ay(count), az(count), gx(count), gy(count), gz(count);
+    std::vector<float> deltat(count, (float)(1 / GYRO_HZ));
+    for (uint32_t k=0; k<count; ++k) {
+        ax[k] = samples[k].a[0];
+        ay[k] = samples[k].a[1];
+        az[k] = samples[k].a[2];
+        gx[k] = samples[k].g[0];
+        gy[k] = samples[k].g[1];
+        gz[k] = samples[k].g[2];
+    }
+
+    hf::MadgwickQuaternionFilter6DOF::block_t block = {};
+
+    hf::MadgwickQuaternionFilter6DOF filter = makeMadgwick6();
+    hf::MadgwickQuaternionFilter6DOF reference = makeMadgwick6();
+    double sumsq = 0, maxError = 0;
+    uint32_t blocks = 0;
+    for (uint32_t start=0; start<count; start+=blockSize) {
+        uint32_t n = count - start < blockSize ? count - start : blockSize;
+        block = {&ax[start], &ay[start], &az[start], &gx[start], &gy[start], &gz[start], &deltat[start], n};
+        filter.update(block);
+        for (uint32_t k=start; k<start+n; ++k) {
+            updateMadgwick6(reference, samples[k], deltat[k]);
+        }
+        // Compared component by component, since errorDegrees() can't resolve differences in the last place
+        double e = fabs(filter.q1 - reference.q1) + fabs(filter.q2 - reference.q2) +
+            fabs(filter.q3 - reference.q3) + fabs(filter.q4 - reference.q4);
+        sumsq += e * e;
+        maxError = e > maxError ? e : maxError;
+        blocks++;
+    }
+
+    block = {&ax[0], &ay[0], &az[0], &gx[0], &gy[0], &gz[0], &deltat[0], count};
+
+    double nsec = timeUpdates(reps, count, [&]() {
+            hf::MadgwickQuaternionFilter6DOF f = makeMadgwick6();
+            f.update(block);
+            sink = f.q1;
+        });
+
+    report("MadgwickQuaternionFilter6DOF blk", nsec, sqrt(sumsq/blocks), maxError, "from update()");
+}
+
+static hf::MahonyQuaternionFilter6DOF makeMahony6(void)
+{
+    return hf::MahonyQuaternionFilter6DOF();
+}
+
+static void updateMahony6(hf::MahonyQuaternionFilter6DOF & f, const sample_t & s, float dt)
+{
+    f.update(s.a[0], s.a[1], s.a[2], s.g[0], s.g[1], s.g[2], dt);
+}
+
+static hf::ComplementaryQuaternionFilter makeComplementary(void)
+{
+    return hf::ComplementaryQuaternionFilter();
+}
+
+static void updateComplementary(hf::ComplementaryQuaternionFilter & f, const sample_t & s, float dt)
+{
+    f.update(s.a[0], s.a[1], s.a[2], s.g[0], s.g[1], s.g[2], dt);
+}
+
+// Attitude as SoftwareQuaternionIMU delivers it, with each estimator's default gains: the estimator runs on every
+// divisor'th gyro sample, and its quaternion is held in between.  Error and time are per gyro sample.
+template <typename Filter>
+static void benchAttitudeRate(const char * name, const std::vector<sample_t> & samples, uint32_t reps,
+        uint8_t divisor, void (*update)(Filter &, const sample_t &, float))
+{
+    const float dt = (float)(divisor / GYRO_HZ);
+    const uint32_t count = samples.size();
+
+    Filter filter;
+    double sumsq = 0, maxError = 0;
+    for (uint32_t k=0; k<count; ++k) {
+        if ((k + 1) % divisor == 0) {
+            update(filter, samples[k], dt);
+        }
+        double e = errorDegrees(samples[k].q, filter.q1, filter.q2, filter.q3, filter.q4);
+        sumsq += e * e;
+        maxError = e > maxError ? e : maxError;
+    }
+
+    double nsec = timeUpdates(reps, count, [&]() {
+            Filter f;
+            for (uint32_t k=divisor-1; k<count; k+=divisor) {
+                update(f, samples[k], dt);
+            }
+            sink = f.q1;
+        });
+
+    char label[40];
+    snprintf(label, sizeof(label), "%s 1/%u gyro rate", name, divisor);
+    report(label, nsec, sqrt(sumsq/count), maxError, "deg");
+}
+
+static hf::MadgwickQuaternionFilter9DOF makeMadgwick9(void)
+{
+    return hf::MadgwickQuaternionFilter9DOF(BETA);
+}
+
+static void updateMadgwick9(hf::MadgwickQuaternionFilter9DOF & f, const sample_t & s, float dt)
+{
+    f.update(s.a[0], s.a[1], s.a[2], s.g[0], s.g[1], s.g[2], s.m[0], s.m[1], s.m[2], dt);
+}
+
+static hf::MahonyQuaternionFilter9DOF makeMahony9(void)
+{
+    return hf::MahonyQuaternionFilter9DOF();
+}
+
+static void updateMahony9(hf::MahonyQuaternionFilter9DOF & f, const sample_t & s, float dt)
+{
+    f.update(s.a[0], s.a[1], s.a[2], s.g[0], s.g[1], s.g[2], s.m[0], s.m[1], s.m[2], dt);
+}
+
+static void benchEulerAngles(const std::vector<sample_t> & samples, uint32_t reps)
+{
+    const uint32_t count = samples.size();
+
+    // Accuracy against the same formulas in double precision; roll and yaw wrap at +/-pi
+    double sumsq = 0, maxError = 0;
+    for (uint32_t k=0; k<count; ++k) {
+        const double * q = samples[k].q;
+        float euler[3];
+        hf::Quaternion::computeEulerAngles(q[0], q[1], q[2], q[3], euler);
+        double ref[3] = {
+            atan2(2*(q[0]*q[1]+q[2]*q[3]), q[0]*q[0]-q[1]*q[1]-q[2]*q[2]+q[3]*q[3]),
+            asin(2*(q[1]*q[3]-q[0]*q[2])),
+            atan2(2*(q[1]*q[2]+q[0]*q[3]), q[0]*q[0]+q[1]*q[1]-q[2]*q[2]-q[3]*q[3])
+        };
+        for (uint8_t i=0; i<3; ++i) {
+            double e = fabs(remainder(euler[i] - ref[i], 2*M_PI)) * 180 / M_PI;
+            sumsq += e * e;
+            maxError = e > maxError ? e : maxError;
+        }
+    }
+
+    std::vector<float> quats(4*count);
+    for (uint32_t k=0; k<count; ++k) {
+        for (uint8_t i=0; i<4; ++i) {
+            quats[4*k+i] = (float)samples[k].q[i];
+        }
+    }
+
+    double nsec = timeUpdates(reps, count, [&]() {
+            float euler[3], sum = 0;
+            for (uint32_t k=0; k<count; ++k) {
+                hf::Quaternion::computeEulerAngles(quats[4*k], quats[4*k+1], quats[4*k+2], quats[4*k+3], euler);
+                sum += euler[0] + euler[1] + euler[2];
+            }
+            sink = sum;
+        });
+
+    report("Quaternion::computeEulerAngles", nsec, sqrt(sumsq/(3*count)), maxError, "deg");
+}
+
+static void benchLowPassFilter(const std::vector<sample_t> & samples, uint32_t reps)
+{
+    static const uint8_t N = 20; // as used by the rangefinder
+
+    const uint32_t count = samples.size();
+
+    // Same recurrence in double precision, from the same input
+    hf::LowPassFilter<N> lpf;
+    lpf.init();
+    double history[N] = {0}, sum = 0;
+    uint8_t index = 0;
+    double sumsq = 0, maxError = 0;
+    for (uint32_t k=0; k<count; ++k) {
+        float x = samples[k].a[0];
+        float y = lpf.update(x);
+        uint8_t next = (index + 1) % N;
+        history[index] = x;
+        sum += x - history[next];
+        index = next;
+        double e = fabs(y - sum/N);
+        sumsq += e * e;
+        maxError = e > maxError ? e : maxError;
+    }
+
+    double nsec = timeUpdates(reps, count, [&]() {
+            hf::LowPassFilter<N> f;
+            f.init();
+            float y = 0;
+            for (uint32_t k=0; k<count; ++k) {
+                y += f.update(samples[k].a[0]);
+            }
+            sink = y;
+        });
+
+    report("LowPassFilter<20>::update", nsec, sqrt(sumsq/count), maxError, "g");
+}
+
+// Double-precision versions of the IIR filters, as references
+class RefBiquad {
+
+    private:
+
+        double _b0 = 1, _b1 = 0, _b2 = 0, _a1 = 0, _a2 = 0;
+        double _z1 = 0, _z2 = 0;
+
+        void set(double b0, double b1, double b2, double a0, double a1, double a2)
+        {
+            _b0 = b0/a0; _b1 = b1/a0; _b2 = b2/a0; _a1 = a1/a0; _a2 = a2/a0;
+        }
+
+    public:
+
+        static RefBiquad pt1(double cutoffHz, double sampleHz)
+        {
+            RefBiquad f;
+            double rc = 1 / (2 * M_PI * cutoffHz), dt = 1 / sampleHz, k = dt / (rc + dt);
+            f.set(k, 0, 0, 1, k-1, 0);
+            return f;
+        }
+
+        static RefBiquad lowpass(double cutoffHz, double sampleHz, double q)
+        {
+            RefBiquad f;
+            double w = 2 * M_PI * cutoffHz / sampleHz, cs = cos(w), alpha = sin(w) / (2 * q);
+            f.set((1-cs)/2, 1-cs, (1-cs)/2, 1+alpha, -2*cs, 1-alpha);
+            return f;
+        }
+
+        static RefBiquad notch(double centerHz, double sampleHz, double q)
+        {
+            RefBiquad f;
+            double w = 2 * M_PI * centerHz / sampleHz, cs = cos(w), alpha = sin(w) / (2 * q);
+            f.set(1, -2*cs, 1, 1+alpha, -2*cs, 1-alpha);
+            return f;
+        }
+
+        double update(double x)
+        {
+            double y = _b0 * x + _z1;
+            _z1 = _b1 * x - _a1 * y + _z2;
+            _z2 = _b2 * x - _a2 * y;
+            return y;
+        }
+
+}; // class RefBiquad
+
+// Filters the gyro, all three axes per update, and scores against the same filter (a cascade of reference
+// sections) in double precision
+template <typename Filter>
+static void benchIirFilter(const char * name, const std::vector<sample_t> & samples, uint32_t reps,
+        Filter (*make)(void), std::vector<RefBiquad> (*makeRef)(void))
+{
+    const uint32_t count = samples.size();
+
+    Filter filter = make();
+    std::vector<RefBiquad> ref[3] = {makeRef(), makeRef(), makeRef()};
+    double sumsq = 0, maxError = 0;
+    for (uint32_t k=0; k<count; ++k) {
+        float g[3] = {samples[k].g[0], samples[k].g[1], samples[k].g[2]};
+        filter.update(g);
+        for (uint8_t j=0; j<3; ++j) {
+            double y = samples[k].g[j];
+            for (RefBiquad & section : ref[j]) {
+                y = section.update(y);
+            }
+            double e = fabs(g[j] - y);
+            sumsq += e * e;
+            maxError = e > maxError ? e : maxError;
+        }
+    }
+
+    double nsec = timeUpdates(reps, count, [&]() {
+            Filter f = make();
+            float sum = 0;
+            for (uint32_t k=0; k<count; ++k) {
+                float g[3] = {samples[k].g[0], samples[k].g[1], samples[k].g[2]};
+                f.update(g);
+                sum += g[0] + g[1] + g[2];
+            }
+            sink = sum;
+        });
+
+    report(name, nsec, sqrt(sumsq/(3*count)), maxError, "rad/s");
+}
+
+static constexpr float LOWPASS_HZ = 90;
+static constexpr float NOTCH_HZ   = 200;
+static constexpr float NOTCH_Q    = 2;
+
+static hf::Pt1Filter<3> makePt1(void)
+{
+    hf::Pt1Filter<3> f;
+    f.init(LOWPASS_HZ, GYRO_HZ);
+    return f;
+}
+
+static std::vector<RefBiquad> makeRefPt1(void)
+{
+    return {RefBiquad::pt1(LOWPASS_HZ, GYRO_HZ)};
+}
+
+static hf::Pt2Filter<3> makePt2(void)
+{
+    hf::Pt2Filter<3> f;
+    f.init(LOWPASS_HZ, GYRO_HZ);
+    return f;
+}
+
+static std::vector<RefBiquad> makeRefPt2(void)
+{
+    return {RefBiquad::pt1(LOWPASS_HZ * 1.553773974, GYRO_HZ), RefBiquad::pt1(LOWPASS_HZ * 1.553773974, GYRO_HZ)};
+}
+
+static hf::BiquadFilter<3> makeLowpass(void)
+{
+    hf::BiquadFilter<3> f;
+    f.initLowpass(LOWPASS_HZ, GYRO_HZ);
+    return f;
+}
+
+static std::vector<RefBiquad> makeRefLowpass(void)
+{
+    return {RefBiquad::lowpass(LOWPASS_HZ, GYRO_HZ, 1/sqrt(2))};
+}
+
+static hf::BiquadFilter<3> makeNotch(void)
+{
+    hf::BiquadFilter<3> f;
+    f.initNotch(NOTCH_HZ, GYRO_HZ, NOTCH_Q);
+    return f;
+}
+
+static std::vector<RefBiquad> makeRefNotch(void)
+{
+    return {RefBiquad::notch(NOTCH_HZ, GYRO_HZ, NOTCH_Q)};
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t reps = argc > 1 ? atoi(argv[1]) : 10;
+
+    std::vector<sample_t> samples = makeMotion();
+
+    printf("%u samples (%3.0f sec at %3.0f Hz), %u repetitions\n\n", (uint32_t)samples.size(), SECONDS, GYRO_HZ, reps);
+
+    benchQuaternionFilter("MadgwickQuaternionFilter6DOF", samples, reps, makeMadgwick6, updateMadgwick6);
+    benchMadgwick6Block(samples, reps);
+    benchQuaternionFilter("MahonyQuaternionFilter6DOF", samples, reps, makeMahony6, updateMahony6);
+    benchQuaternionFilter("ComplementaryQuaternionFilter", samples, reps, makeComplementary, updateComplementary);
+    benchQuaternionFilter("MadgwickQuaternionFilter9DOF", samples, reps, makeMadgwick9, updateMadgwick9);
+    benchQuaternionFilter("MahonyQuaternionFilter9DOF", samples, reps, makeMahony9, updateMahony9);
+    printf("\nAs SoftwareQuaternionIMU runs them, with default gains; per gyro sample:\n");
+    for (uint8_t divisor : {1, 5}) {
+        benchAttitudeRate("Madgwick6DOF", samples, reps, divisor, updateMadgwick6);
+        benchAttitudeRate("Mahony6DOF", samples, reps, divisor, updateMahony6);
+        benchAttitudeRate("Complementary", samples, reps, divisor, updateComplementary);
+    }
+    printf("\n");
+
+    benchEulerAngles(samples, reps);
+    benchLowPassFilter(samples, reps);
+    benchIirFilter("Pt1Filter<3>::update", samples, reps, makePt1, makeRefPt1);
+    benchIirFilter("Pt2Filter<3>::update", samples, reps, makePt2, makeRefPt2);
+    benchIirFilter("BiquadFilter<3>::update lowpass", samples, reps, makeLowpass, makeRefLowpass);
+    benchIirFilter("BiquadFilter<3>::update notch", samples, reps, makeNotch, makeRefNotch);
+
+    return 0;
+}
@@ -0,0 +1,282 @@
+/*
+   End-to-end benchmark of the Hackflight control loop
+
+   Drives fully wired Hackflight and StaticHackflight instances on the host
+   shim's virtual clock, charging each update a fixed loop time, so the PID,
+   serial, and sensor tasks come due at the same rates as on a board.  Wall
+   time is measured for every update.  Results go to stdout as JSON.
+
+   Gyro-to-motor latency is given two ways: gyro_to_motor_usec is how long,
+   on the virtual clock, a sample waits for the loop to act on it (always
+   zero in gyro-sync mode, which acts on the sample as it arrives), and
+   gyro_to_motor_ns is the wall time from reading the sample to writing the
+   first motor, which includes the processing in between.
+
+   Usage: hackflight_bench_loop [ITERATIONS]
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "sitl.hpp"
+#include "statichackflight.hpp"
+#include "boards/realboards/arduino/mock.hpp"
+#include "sensors/rangefinder.hpp"
+#include "actuators/mixers/quadxap.hpp"
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/level.hpp"
+#include "pidcontrollers/althold.hpp"
+
+static constexpr uint8_t  LED_PIN   = 13;
+static constexpr uint32_t LOOP_USEC = 100;  // typical for a 10 kHz main loop
+static constexpr float    GYRO_HZ   = 834;
+
+// Notes when each gyro sample was delivered, and makes the samples vary so the motors see new values
+class BenchIMU : public hf::SimIMU {
+
+    public:
+
+        uint32_t sampleUsec = 0;
+
+        std::chrono::steady_clock::time_point sampleTime;
+
+        BenchIMU(void)
+            : SimIMU(GYRO_HZ)
+        {
+        }
+
+    protected:
+
+        virtual bool getGyrometer(float & gx, float & gy, float & gz) override
+        {
+            if (!SimIMU::getGyrometer(gx, gy, gz)) {
+                return false;
+            }
+
+            sampleUsec = micros();
+            sampleTime = std::chrono::steady_clock::now();
+
+            float t = sampleUsec / 1.e6f;
+            gx = 0.2f * sin(7*t);
+            gy = 0.2f * cos(5*t);
+            gz = 0.1f * sin(3*t);
+
+            return true;
+        }
+
+}; // class BenchIMU
+
+// Records the age of the newest gyro sample, on both clocks, whenever the mixer writes the motors
+class BenchMotor : public hf::SimMotor {
+
+    public:
+
+        const BenchIMU * imu = NULL;
+
+        std::vector<uint32_t> gyroAges;
+        std::vector<uint32_t> gyroNsecs;
+
+        virtual void write(uint8_t index, float value) override
+        {
+            SimMotor::write(index, value);
+
+            if (index == 0 && imu) {
+                gyroAges.push_back(micros() - imu->sampleUsec);
+                gyroNsecs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - imu->sampleTime).count());
+            }
+        }
+
+}; // class BenchMotor
+
+class BenchRangefinder : public hf::Rangefinder {
+
+    protected:
+
+        virtual bool distanceAvailable(float & distance) override
+        {
+            distance = 1 + 0.1f * sin(micros() / 1.e6f);
+
+            return true;
+        }
+
+}; // class BenchRangefinder
+
+typedef hf::StaticHackflight<hf::MockBoard, BenchIMU, hf::SimReceiver, hf::MixerQuadXAP, BenchMotor,
+        hf::LevelPid, hf::RatePid, hf::AltitudeHoldPid> StaticBench;
+
+static hf::RatePid ratePid(void)
+{
+    return hf::RatePid(0.05f, 0.00f, 0.00f, 0.10f, 0.01f); 
+}
+
+static hf::LevelPid levelPid(void)
+{
+    return hf::LevelPid(0.20f);
+}
+
+static hf::AltitudeHoldPid altholdPid(void)
+{
+    return hf::AltitudeHoldPid(1.00f, 0.15f, 0.01f, 0.05f);
+}
+
+static uint32_t percentile(const std::vector<uint32_t> & sorted, double p)
+{
+    return sorted.empty() ? 0 : sorted[(size_t)(p * (sorted.size() - 1))];
+}
+
+static double mean(const std::vector<uint32_t> & values)
+{
+    double sum = 0;
+
+    for (size_t k=0; k<values.size(); ++k) {
+        sum += values[k];
+    }
+
+    return values.empty() ? 0 : sum / values.size();
+}
+
+// Arms with throttle down, then flies in altitude-hold mode while we time the loop
+template <typename H>
+static void runConfig(const char * name, H & h, hf::SimReceiver & rc, BenchMotor & motors, uint32_t iterations,
+        bool last)
+{
+    // Disarmed, throttle down, then arm
+    for (uint32_t k=0; k<1000000/LOOP_USEC; ++k) {
+        h.update();
+        hostAdvanceClock(LOOP_USEC);
+        if (k == 500000/LOOP_USEC) {
+            rc.setChannels(-1, 0, 0, 0, +1, +1);
+        }
+    }
+
+    rc.setChannels(0, 0.1f, -0.1f, 0, +1, +1);
+
+    motors.gyroAges.clear();
+    motors.gyroNsecs.clear();
+
+    std::vector<uint32_t> nsec(iterations);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (uint32_t k=0; k<iterations; ++k) {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        h.update();
+        nsec[k] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+        hostAdvanceClock(LOOP_USEC);
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double nsecMean = mean(nsec);
+    std::sort(nsec.begin(), nsec.end());
+
+    double ageMean = mean(motors.gyroAges);
+    std::vector<uint32_t> & ages = motors.gyroAges;
+    std::sort(ages.begin(), ages.end());
+
+    double gyroNsecMean = mean(motors.gyroNsecs);
+    std::vector<uint32_t> & gyroNsecs = motors.gyroNsecs;
+    std::sort(gyroNsecs.begin(), gyroNsecs.end());
+
+    printf("    {\"name\": \"%s\", \"iterations_per_sec\": %.0f, "
+            "\"latency_ns\": {\"mean\": %.1f, \"p50\": %u, \"p90\": %u, \"p99\": %u, \"p999\": %u, \"max\": %u}, "
+            "\"motor_updates\": %u, "
+            "\"gyro_to_motor_usec\": {\"mean\": %.1f, \"p50\": %u, \"p99\": %u, \"max\": %u}, "
+            "\"gyro_to_motor_ns\": {\"mean\": %.1f, \"p50\": %u, \"p99\": %u, \"max\": %u}}%s\n",
+            name, iterations / elapsed,
+            nsecMean, percentile(nsec, .5), percentile(nsec, .9), percentile(nsec, .99), percentile(nsec, .999),
+            nsec.back(),
+            (uint32_t)ages.size(), ageMean, percentile(ages, .5), percentile(ages, .99), ages.empty() ? 0 : ages.back(),
+            gyroNsecMean, percentile(gyroNsecs, .5), percentile(gyroNsecs, .99), gyroNsecs.empty() ? 0 : gyroNsecs.back(),
+            last ? "" : ",");
+}
+
+static void runDynamic(const char * name, uint32_t iterations, bool gyroSync, bool rangefinder, bool last)
+{
+    hostUseVirtualClock();
+
+    hf::Hackflight h;
+    hf::MockBoard board(LED_PIN);
+    BenchIMU imu;
+    hf::SimReceiver rc;
+    hf::MixerQuadXAP mixer;
+    BenchMotor motors;
+    hf::LevelPid level = levelPid();
+    hf::RatePid rate = ratePid();
+    hf::AltitudeHoldPid althold = altholdPid();
+    BenchRangefinder rangefinderSensor;
+
+    motors.imu = &imu;
+
+    h.init(&board, &imu, &rc, &mixer, &motors);
+    h.addPidController(&level);
+    h.addPidController(&rate);
+    h.addPidController(&althold, 1);
+
+    if (rangefinder) {
+        h.addSensor(&rangefinderSensor);
+    }
+
+    h.setGyroSync(gyroSync);
+
+    runConfig(name, h, rc, motors, iterations, last);
+}
+
+static void runStatic(const char * name, uint32_t iterations, bool gyroSync, bool last)
+{
+    hostUseVirtualClock();
+
+    hf::MockBoard board(LED_PIN);
+
+    StaticBench h(BenchIMU(), hf::SimReceiver(), hf::MixerQuadXAP(), BenchMotor(), levelPid(), ratePid(), altholdPid());
+
+    h.setAuxState(2, 1);
+
+    h.getMotors().imu = &h.getImu();
+
+    h.init(&board);
+
+    h.setGyroSync(gyroSync);
+
+    runConfig(name, h, h.getReceiver(), h.getMotors(), iterations, last);
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    printf("{\n  \"benchmark\": \"control_loop\",\n  \"iterations\": %u,\n  \"loop_usec\": %u,\n"
+            "  \"gyro_hz\": %.0f,\n  \"configs\": [\n", iterations, LOOP_USEC, GYRO_HZ);
+
+    runDynamic("hackflight", iterations, false, true, false);
+    runDynamic("hackflight_gyrosync", iterations, true, true, false);
+
+    // Without the rangefinder, for comparison with StaticHackflight, which has no optional sensors
+    runDynamic("hackflight_core", iterations, false, false, false);
+    runStatic("static_hackflight", iterations, false, false);
+    runDynamic("hackflight_core_gyrosync", iterations, true, false, false);
+    runStatic("static_hackflight_gyrosync", iterations, true, true);
+
+    printf("  ]\n}\n");
+
+    return 0;
+}
@@ -0,0 +1,35 @@
+/*
+   Pass/fail reporting for the host test programs: each check prints a PASS
+   or FAIL line, and main() returns failures ? 1 : 0 for CTest
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Each test is a single program, so one count per translation unit is all we need
+static uint32_t failures = 0;
+
+static void check(bool ok, const char * what)
+{
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+
+    failures += !ok;
+}
@@ -0,0 +1,196 @@
+/*
+   Flies a scripted mission in closed loop against the rigid-body multirotor
+   model: take off, hold altitude, then step roll, pitch, and yaw.  Prints the
+   vehicle's true state twice a second, and optionally records the sensor and
+   receiver readings for hackflight_replay.  SECONDS cuts the script short or
+   repeats it (default: once through).  A raw recording holds accelerometer
+   readings in place of the quaternion, for hackflight_golden, with sensor
+   noise and a 50 Hz rangefinder.
+
+   Usage: hackflight_flight [quad|octo] [SECONDS] [RECORDING] [raw]
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "sitl.hpp"
+#include "multirotor.hpp"
+#include "replay.hpp"
+#include "boards/realboards/arduino/mock.hpp"
+#include "actuators/mixers/quadxap.hpp"
+#include "actuators/mixers/octoxap.hpp"
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/level.hpp"
+#include "pidcontrollers/althold.hpp"
+
+static constexpr uint8_t  LED_PIN     = 13;
+static constexpr uint32_t LOOP_USEC   = 100;    // typical for a 10 kHz main loop
+static constexpr uint32_t REPORT_USEC = 500000;
+
+// Raw recordings model a board's sensors more closely, rangefinder rate included
+static constexpr float RAW_RANGE_HZ = 50;
+
+// Sticks over time: throttle, roll, pitch, yaw, and the arming switch (aux1); aux2 selects altitude hold
+typedef struct {
+
+    float seconds;
+    float sticks[4];
+    float aux1;
+
+} segment_t;
+
+static const segment_t SCRIPT[] = {
+    { 1, { -1,    0,    0,    0    }, -1 }, // disarmed on the ground
+    { 1, { -1,    0,    0,    0    }, +1 }, // arm
+    { 2, { +0.4f, 0,    0,    0    }, +1 }, // climb
+    { 4, {  0,    0,    0,    0    }, +1 }, // hold
+    { 2, {  0,   +0.2f, 0,    0    }, +1 }, // roll right
+    { 2, {  0,    0,    0,    0    }, +1 },
+    { 2, {  0,    0,   +0.2f, 0    }, +1 }, // pitch forward
+    { 2, {  0,    0,    0,    0    }, +1 },
+    { 2, {  0,    0,    0,   +0.3f }, +1 }, // yaw
+    { 2, {  0,    0,    0,    0    }, +1 },
+    { 2, { -0.4f, 0,    0,    0    }, +1 }, // descend
+    { 1, { -1,    0,    0,    0    }, -1 }, // disarm
+};
+
+int main(int argc, char ** argv)
+{
+    bool octo = argc > 1 && !strcmp(argv[1], "octo");
+
+    float seconds = argc > 2 ? atof(argv[2]) : 0;
+
+    bool raw = argc > 4 && !strcmp(argv[4], "raw");
+
+    FILE * recording = argc > 3 ? fopen(argv[3], "wb") : NULL;
+    if (argc > 3 && !recording) {
+        fprintf(stderr, "Unable to open %s\n", argv[3]);
+        return 1;
+    }
+
+    // Must come first, to put the clock under our control
+    hf::Sitl sitl(LOOP_USEC);
+
+    hf::Hackflight h;
+
+    hf::MockBoard board(LED_PIN);
+
+    hf::SimIMU imu;
+
+    hf::SimReceiver rc;
+
+    hf::MixerQuadXAP quadMixer;
+    hf::MixerOctoXAP octoMixer;
+
+    hf::SimMotor motors(octo ? 8 : 4);
+
+    hf::SimRangefinder rangefinder(raw ? RAW_RANGE_HZ : 0);
+
+    // A perfectly level, noiseless IMU is nothing a software estimator will see on a board
+    hf::multirotorParams_t params;
+    if (raw) {
+        params.gyroNoise = 0.01;
+        params.accelNoise = 0.01;
+    }
+
+    hf::Multirotor vehicle(octo ? hf::OCTOXAP_GEOMETRY : hf::QUADXAP_GEOMETRY, octo ? 8 : 4, params);
+
+    hf::RatePid ratePid = hf::RatePid(0.05f, 0.00f, 0.00f, 0.10f, 0.01f);
+
+    hf::LevelPid levelPid = hf::LevelPid(0.20f);
+
+    hf::AltitudeHoldPid altholdPid = hf::AltitudeHoldPid(1.00f, 0.15f, 0.01f, 0.05f);
+
+    // Hackflight sees the recording wrappers when recording, the simulated components otherwise
+    hf::FileRecorder recorder(recording);
+    hf::RecordingIMU recordingImu(&imu, &recorder, raw);
+    hf::RecordingReceiver recordingRc(&rc, &recorder);
+    hf::RecordingRangefinder recordingRangefinder(&rangefinder, &recorder);
+
+    if (recording) {
+        recorder.begin(&board);
+    }
+
+    h.init(&board, recording ? (hf::IMU *)&recordingImu : &imu, recording ? (hf::Receiver *)&recordingRc : &rc,
+            octo ? (hf::Mixer *)&octoMixer : (hf::Mixer *)&quadMixer, &motors);
+
+    h.addSensor(recording ? (hf::Sensor *)&recordingRangefinder : &rangefinder);
+
+    h.addPidController(&levelPid);
+    h.addPidController(&ratePid);
+    h.addPidController(&altholdPid, 1);
+
+    sitl.begin(&h);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    printf("    time      x      y    alt   roll  pitch    yaw\n");
+
+    uint32_t usec = 0;
+    uint32_t report = 0;
+
+    uint32_t stop = seconds > 0 ? (uint32_t)(seconds * 1e6f) : UINT32_MAX;
+
+    // Repeat the script as needed to fill the requested time
+    float total = 0;
+    do {
+        for (uint8_t s=0; s<sizeof(SCRIPT)/sizeof(segment_t); ++s) {
+
+            const float * sticks = SCRIPT[s].sticks;
+            rc.setChannels(sticks[0], sticks[1], sticks[2], sticks[3], SCRIPT[s].aux1, +1);
+
+            uint32_t end = usec + (uint32_t)(SCRIPT[s].seconds * 1e6f);
+
+            for (; usec<end && usec<stop; usec+=LOOP_USEC) {
+
+                vehicle.writeImu(imu);
+                vehicle.writeRangefinder(rangefinder);
+
+                sitl.step();
+
+                vehicle.readMotors(motors);
+                vehicle.update(LOOP_USEC);
+
+                if (usec >= report) {
+                    double pos[3] = {0}, angles[3] = {0};
+                    vehicle.getPosition(pos);
+                    vehicle.getEulerAngles(angles);
+                    printf("%8.1f %6.2f %6.2f %6.2f %6.1f %6.1f %6.1f\n", usec/1e6, pos[0], pos[1], vehicle.getAltitude(),
+                            angles[0]*180/M_PI, angles[1]*180/M_PI, angles[2]*180/M_PI);
+                    report += REPORT_USEC;
+                }
+            }
+
+            total += SCRIPT[s].seconds;
+        }
+
+    } while (total < seconds);
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("Flew %3.1f sec in %3.3f sec (%3.0fx real time)\n", usec / 1e6, wall, usec / 1e6 / wall);
+    printf("%u motor writes, checksum %016llx\n", motors.getWrites(), (unsigned long long)motors.getChecksum());
+
+    if (recording) {
+        fclose(recording);
+    }
+
+    return 0;
+}
@@ -0,0 +1,291 @@
+/*
+   Golden-trace check for the controller: replays a raw recording from
+   hackflight_flight (gyrometer and accelerometer readings) through the
+   software quaternion estimator and Hackflight (PID controllers, mixer,
+   motors), and either saves the motor values as a golden trace, or compares
+   them with a saved one, sample by sample, within a tolerance in units in the
+   last place.
+
+   Save a golden trace with the current code before optimizing filters.hpp,
+   pidcontroller.hpp, mixer.hpp, and the like; then check against it after.
+   CTest checks extras/host/data/flight.golden against flight.hfr (bit-exact,
+   or within 16 ulps with HACKFLIGHT_FAST_MATH), made with
+
+       hackflight_flight quad 4 flight.hfr raw
+       hackflight_golden save flight.hfr flight.golden
+
+   Usage: hackflight_golden save  RECORDING GOLDEN [quad|octo]
+          hackflight_golden check RECORDING GOLDEN [MAX_ULPS]
+
+   The check exits with status 1 if any motor value differs by more than
+   MAX_ULPS (default 0, for bit-exact).
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "sitl.hpp"
+#include "replay.hpp"
+#include "boards/realboards/arduino/mock.hpp"
+#include "actuators/mixers/quadxap.hpp"
+#include "actuators/mixers/octoxap.hpp"
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/level.hpp"
+#include "pidcontrollers/althold.hpp"
+
+static constexpr uint8_t  LED_PIN   = 13;
+static constexpr uint32_t LOOP_USEC = 100;  // as in hackflight_flight
+
+static constexpr uint8_t MAX_MOTORS = 8;
+
+// File starts with 'H', 'F', 'G', version, motor count; then one sample per update in which the motors
+// were written: the update number, and every motor's value
+static const uint8_t GOLDEN_VERSION = 1;
+
+typedef struct {
+
+    uint32_t update;
+    float values[MAX_MOTORS];
+
+} sample_t;
+
+// The same vehicle as hackflight_flight and hackflight_replay, fed by a recording
+class Vehicle {
+
+    private:
+
+        hf::Hackflight _h;
+
+        hf::MockBoard _board = hf::MockBoard(LED_PIN);
+
+        hf::ReplayEstimatorIMU<> _imu;
+
+        hf::ReplayReceiver _rc;
+
+        hf::ReplayRangefinder _rangefinder;
+
+        hf::MixerQuadXAP _quadMixer;
+        hf::MixerOctoXAP _octoMixer;
+
+        hf::RatePid _ratePid = hf::RatePid(0.05f, 0.00f, 0.00f, 0.10f, 0.01f);
+
+        hf::LevelPid _levelPid = hf::LevelPid(0.20f);
+
+        hf::AltitudeHoldPid _altholdPid = hf::AltitudeHoldPid(1.00f, 0.15f, 0.01f, 0.05f);
+
+    public:
+
+        hf::SimMotor motors;
+
+        uint8_t nmotors;
+
+        Vehicle(hf::Replay * replay, hf::Sitl & sitl, bool octo)
+            : _imu(replay), _rc(replay), _rangefinder(replay), motors(octo ? 8 : 4), nmotors(octo ? 8 : 4)
+        {
+            _h.init(&_board, &_imu, &_rc, octo ? (hf::Mixer *)&_octoMixer : (hf::Mixer *)&_quadMixer, &motors);
+
+            _h.addSensor(&_rangefinder);
+
+            _h.addPidController(&_levelPid);
+            _h.addPidController(&_ratePid);
+            _h.addPidController(&_altholdPid, 1);
+
+            sitl.begin(&_h);
+        }
+
+}; // class Vehicle
+
+// Distance between two floats in representable values, with -0 and +0 the same
+static uint32_t ulps(float a, float b)
+{
+    if (a != a || b != b) {
+        return (a != a && b != b) ? 0 : UINT32_MAX;
+    }
+
+    int32_t ia = 0, ib = 0;
+    memcpy(&ia, &a, 4);
+    memcpy(&ib, &b, 4);
+
+    // Map sign-magnitude to a monotonic two's-complement ordering
+    int64_t oa = ia < 0 ? (int64_t)INT32_MIN - ia : ia;
+    int64_t ob = ib < 0 ? (int64_t)INT32_MIN - ib : ib;
+
+    int64_t d = oa > ob ? oa - ob : ob - oa;
+
+    return d > UINT32_MAX ? UINT32_MAX : (uint32_t)d;
+}
+
+static bool loadGolden(const char * path, uint8_t & nmotors, std::vector<sample_t> & samples)
+{
+    FILE * file = fopen(path, "rb");
+
+    if (!file) {
+        return false;
+    }
+
+    uint8_t header[5] = {0};
+    bool ok = fread(header, 1, 5, file) == 5 && !memcmp(header, "HFG", 3) && header[3] == GOLDEN_VERSION &&
+        header[4] > 0 && header[4] <= MAX_MOTORS;
+
+    nmotors = header[4];
+
+    sample_t sample = {};
+    while (ok && fread(&sample.update, 4, 1, file) == 1) {
+        ok = fread(sample.values, 4, nmotors, file) == nmotors;
+        samples.push_back(sample);
+    }
+
+    fclose(file);
+
+    return ok;
+}
+
+int main(int argc, char ** argv)
+{
+    bool save = argc > 1 && !strcmp(argv[1], "save");
+    bool check = argc > 1 && !strcmp(argv[1], "check");
+
+    if (argc < 4 || !(save || check)) {
+        fprintf(stderr, "Usage: %s save  RECORDING GOLDEN [quad|octo]\n", argv[0]);
+        fprintf(stderr, "       %s check RECORDING GOLDEN [MAX_ULPS]\n", argv[0]);
+        return 2;
+    }
+
+    hf::Replay replay;
+
+    if (!replay.load(argv[2])) {
+        fprintf(stderr, "Unable to load %s\n", argv[2]);
+        return 2;
+    }
+
+    if (!replay.records(hf::Recorder::RECORD_ACCELEROMETER)) {
+        fprintf(stderr, "%s has no accelerometer readings: record it with hackflight_flight ... raw\n", argv[2]);
+        return 2;
+    }
+
+    uint8_t nmotors = argc > 4 && !strcmp(argv[4], "octo") ? 8 : 4;
+    uint32_t maxUlps = 0;
+
+    std::vector<sample_t> golden;
+
+    if (check) {
+        if (!loadGolden(argv[3], nmotors, golden)) {
+            fprintf(stderr, "Unable to load %s\n", argv[3]);
+            return 2;
+        }
+        maxUlps = argc > 4 ? atoi(argv[4]) : 0;
+    }
+
+    // Must come first, to put the clock under our control
+    hf::Sitl sitl(LOOP_USEC);
+
+    Vehicle vehicle(&replay, sitl, nmotors == 8);
+
+    FILE * out = NULL;
+
+    if (save) {
+        out = fopen(argv[3], "wb");
+        if (!out) {
+            fprintf(stderr, "Unable to open %s\n", argv[3]);
+            return 2;
+        }
+        const uint8_t header[5] = {'H', 'F', 'G', GOLDEN_VERSION, nmotors};
+        fwrite(header, 1, 5, out);
+    }
+
+    uint32_t samples = 0;
+    uint32_t failures = 0;
+    uint32_t worstUlps = 0;
+    uint32_t worstUpdate = 0;
+
+    // Golden sample in force at the current update
+    uint32_t g = 0;
+
+    uint32_t writes = 0;
+
+    for (uint32_t update=0; (int32_t)(micros() - replay.lastUsec()) <= 0; ++update) {
+
+        sitl.step();
+
+        bool wrote = vehicle.motors.getWrites() != writes;
+        writes = vehicle.motors.getWrites();
+
+        sample_t sample = {update, {0}};
+        for (uint8_t i=0; i<nmotors; ++i) {
+            sample.values[i] = vehicle.motors.getValue(i);
+        }
+
+        if (save) {
+            if (wrote) {
+                fwrite(&sample.update, 4, 1, out);
+                fwrite(sample.values, 4, nmotors, out);
+                samples++;
+            }
+            continue;
+        }
+
+        // Compare wherever either run wrote the motors
+        bool goldenWrote = g < golden.size() && golden[g].update == update;
+
+        if (!(wrote || goldenWrote)) {
+            continue;
+        }
+
+        // Advance to the latest golden sample at or before this update; before the first, motors are at zero
+        while (g < golden.size() && golden[g].update <= update) {
+            g++;
+        }
+        static const float zeros[MAX_MOTORS] = {0};
+        const float * expected = g > 0 ? golden[g-1].values : zeros;
+
+        samples++;
+
+        for (uint8_t i=0; i<nmotors; ++i) {
+
+            uint32_t d = ulps(sample.values[i], expected[i]);
+
+            if (d > worstUlps) {
+                worstUlps = d;
+                worstUpdate = update;
+            }
+
+            if (d > maxUlps) {
+                if (failures < 10) {
+                    printf("update %u (%3.4f sec) motor %u: expected %.9g, got %.9g (%u ulps)\n",
+                            update, update * LOOP_USEC / 1e6, i, expected[i], sample.values[i], d);
+                }
+                failures++;
+            }
+        }
+    }
+
+    if (save) {
+        fclose(out);
+        printf("Saved %u samples of %u motors\n", samples, nmotors);
+        return 0;
+    }
+
+    printf("Compared %u samples of %u motors: %u over %u ulps; worst %u ulps at update %u\n",
+            samples, nmotors, failures, maxUlps, worstUlps, worstUpdate);
+
+    printf(failures ? "FAIL\n" : "PASS\n");
+
+    return failures ? 1 : 0;
+}
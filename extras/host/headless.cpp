@@ -0,0 +1,75 @@
+/*
+   Runs Hackflight on a host computer with mock board, IMU, receiver, and motors
+
+   Usage: hackflight_headless [SECONDS]
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+
+#include <Arduino.h>
+
+#include "hackflight.hpp"
+#include "boards/realboards/arduino/mock.hpp"
+#include "imus/mock.hpp"
+#include "receivers/mock.hpp"
+#include "motors/mock.hpp"
+#include "actuators/mixers/quadxap.hpp"
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/level.hpp"
+
+static constexpr uint8_t LED_PIN = 13;
+
+int main(int argc, char ** argv)
+{
+    float seconds = argc > 1 ? atof(argv[1]) : 1;
+
+    hf::Hackflight h;
+
+    hf::MockBoard board(LED_PIN);
+
+    hf::MockIMU imu;
+
+    hf::MockReceiver rc;
+
+    hf::MixerQuadXAP mixer;
+
+    hf::MockMotor motors;
+
+    hf::RatePid ratePid = hf::RatePid(0.05f, 0.00f, 0.00f, 0.10f, 0.01f); 
+
+    hf::LevelPid levelPid = hf::LevelPid(0.20f);
+
+    h.init(&board, &imu, &rc, &mixer, &motors);
+
+    h.addPidController(&levelPid);
+    h.addPidController(&ratePid);
+
+    uint32_t start = micros();
+    uint32_t duration = (uint32_t)(1e6 * seconds);
+    uint32_t count = 0;
+
+    while ((uint32_t)(micros() - start) < duration) {
+        h.update();
+        count++;
+    }
+
+    printf("%u updates in %3.3f sec: %3.3f usec per update\n", count, seconds, 1e6 * seconds / count);
+
+    return 0;
+}
@@ -0,0 +1,304 @@
+/*
+   Flies a batch of randomized closed-loop flights in parallel and writes one
+   CSV row of metrics per flight.  Each flight has its own Hackflight, vehicle
+   model, and virtual clock, with gains, sensor noise, wind, and frame drawn
+   from a generator seeded by the flight number, so a batch gives the same
+   results whatever the number of threads.
+
+   Usage: hackflight_montecarlo [FLIGHTS] [THREADS] [SEED] > flights.csv
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "sitl.hpp"
+#include "multirotor.hpp"
+#include "workpool.hpp"
+#include "boards/realboards/arduino/mock.hpp"
+#include "actuators/mixers/quadxap.hpp"
+#include "actuators/mixers/quadxcf.hpp"
+#include "actuators/mixers/octoxap.hpp"
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/level.hpp"
+#include "pidcontrollers/althold.hpp"
+
+static constexpr uint8_t  LED_PIN   = 13;
+static constexpr uint32_t LOOP_USEC = 100;
+
+// Mission timing, seconds
+static constexpr float DISARMED_SEC = 0.5f;
+static constexpr float ARM_SEC      = 0.5f;
+static constexpr float CLIMB_SEC    = 1.5f;
+static constexpr float HOLD_SEC     = 3.0f;
+static constexpr float STEP_SEC     = 10.0f;
+
+static constexpr float CLIMB_THROTTLE = 0.4f;
+static constexpr float STEP_ROLL      = 0.5f;
+
+// Response has settled once it stays within this fraction of its final value
+static constexpr float SETTLING_BAND = 0.05f;
+
+// Attitude beyond which we call the flight a crash
+static constexpr float CRASH_DEGREES = 60;
+
+// Hover in ground effect, or below, counts as a crash too
+static constexpr float CRASH_ALTITUDE = 0.05f;
+
+static const char * FRAMES[] = {"quadxap", "quadxcf", "octoxap"};
+
+typedef struct {
+
+    // Inputs
+    uint8_t frame;
+    float ratePitchRollP;
+    float ratePitchRollD;
+    float rateYawP;
+    float levelP;
+    float altVelP;
+    float gyroNoise;
+    float windSpeed;
+    float gust;
+
+    // Metrics
+    float rollSettleSec;
+    float rollOvershootPct;
+    float altitudeRms;
+    float saturationPct;
+    bool  crashed;
+
+} flight_t;
+
+static float uniform(std::mt19937 & rng, float lo, float hi)
+{
+    return std::uniform_real_distribution<float>(lo, hi)(rng);
+}
+
+static void randomize(flight_t & f, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+
+    f.frame          = std::uniform_int_distribution<int>(0, 2)(rng);
+    f.ratePitchRollP = uniform(rng, 0.025f, 0.10f);
+    f.ratePitchRollD = uniform(rng, 0, 0.05f);
+    f.rateYawP       = uniform(rng, 0.05f, 0.20f);
+    f.levelP         = uniform(rng, 0.10f, 0.40f);
+    f.altVelP        = uniform(rng, 0.075f, 0.30f);
+    f.gyroNoise      = uniform(rng, 0, 0.05f);
+    f.windSpeed      = uniform(rng, 0, 3);
+    f.gust           = uniform(rng, 0, 0.5f);
+}
+
+static void fly(flight_t & f, uint32_t seed)
+{
+    // Must come first, to put this thread's clock under our control
+    hf::Sitl sitl(LOOP_USEC);
+
+    hf::Hackflight h;
+
+    hf::MockBoard board(LED_PIN);
+
+    hf::SimIMU imu;
+
+    hf::SimReceiver rc;
+
+    hf::SimRangefinder rangefinder;
+
+    hf::MixerQuadXAP quadxap;
+    hf::MixerQuadXCF quadxcf;
+    hf::MixerOctoXAP octoxap;
+
+    hf::Mixer * mixers[3] = {&quadxap, &quadxcf, &octoxap};
+    static const hf::motorGeometry_t * geometries[3] = {hf::QUADXAP_GEOMETRY, hf::QUADXCF_GEOMETRY, hf::OCTOXAP_GEOMETRY};
+    static const uint8_t nmotors[3] = {4, 4, 8};
+
+    hf::SimMotor motors(nmotors[f.frame]);
+
+    hf::multirotorParams_t params;
+    params.gyroNoise = f.gyroNoise;
+    params.wind[0] = f.windSpeed;
+    params.gust = f.gust;
+    params.seed = seed;
+
+    hf::Multirotor vehicle(geometries[f.frame], nmotors[f.frame], params);
+
+    hf::RatePid ratePid = hf::RatePid(f.ratePitchRollP, 0, f.ratePitchRollD, f.rateYawP, 0.01f);
+
+    hf::LevelPid levelPid = hf::LevelPid(f.levelP);
+
+    hf::AltitudeHoldPid altholdPid = hf::AltitudeHoldPid(1.00f, f.altVelP, 0.01f, 0.05f);
+
+    h.init(&board, &imu, &rc, mixers[f.frame], &motors);
+
+    h.addSensor(&rangefinder);
+
+    h.addPidController(&levelPid);
+    h.addPidController(&ratePid);
+    h.addPidController(&altholdPid, 1);
+
+    sitl.begin(&h);
+
+    const uint32_t armUsec   = (uint32_t)(1e6f * DISARMED_SEC);
+    const uint32_t climbUsec = armUsec   + (uint32_t)(1e6f * ARM_SEC);
+    const uint32_t holdUsec  = climbUsec + (uint32_t)(1e6f * CLIMB_SEC);
+    const uint32_t stepUsec  = holdUsec  + (uint32_t)(1e6f * HOLD_SEC);
+    const uint32_t endUsec   = stepUsec  + (uint32_t)(1e6f * STEP_SEC);
+
+    // Roll response during the step, sampled every loop
+    std::vector<float> roll;
+    roll.reserve((endUsec - stepUsec) / LOOP_USEC);
+
+    double holdAltitude = 0;
+    double altitudeSquaredError = 0;
+    uint32_t holdSamples = 0;
+
+    uint32_t flyingSamples = 0;
+    uint32_t saturatedSamples = 0;
+
+    f.crashed = false;
+
+    for (uint32_t usec=0; usec<endUsec; usec+=LOOP_USEC) {
+
+        float throttle = usec < climbUsec ? -1 : usec < holdUsec ? CLIMB_THROTTLE : 0;
+        float aux1 = usec < armUsec ? -1 : +1;
+        rc.setChannels(throttle, usec < stepUsec ? 0 : STEP_ROLL, 0, 0, aux1, +1);
+
+        vehicle.writeImu(imu);
+        vehicle.writeRangefinder(rangefinder);
+
+        sitl.step();
+
+        vehicle.readMotors(motors);
+        vehicle.update(LOOP_USEC);
+
+        if (usec < holdUsec) {
+            continue;
+        }
+
+        double angles[3] = {0};
+        vehicle.getEulerAngles(angles);
+
+        double altitude = vehicle.getAltitude();
+
+        if (fabs(angles[0]) > hf::Filter::deg2rad(CRASH_DEGREES) ||
+                fabs(angles[1]) > hf::Filter::deg2rad(CRASH_DEGREES) ||
+                altitude < CRASH_ALTITUDE) {
+            f.crashed = true;
+            break;
+        }
+
+        // Altitude hold starts its target where the throttle stick enters the deadband
+        if (usec == holdUsec) {
+            holdAltitude = altitude;
+        }
+
+        if (usec < stepUsec) {
+            altitudeSquaredError += (altitude - holdAltitude) * (altitude - holdAltitude);
+            holdSamples++;
+        }
+        else {
+            roll.push_back(angles[0]);
+        }
+
+        bool saturated = false;
+        for (uint8_t i=0; i<nmotors[f.frame]; ++i) {
+            float value = motors.getValue(i);
+            if (value <= 0 || value >= 1) {
+                saturated = true;
+            }
+        }
+        flyingSamples++;
+        saturatedSamples += saturated;
+    }
+
+    f.altitudeRms = holdSamples ? sqrt(altitudeSquaredError / holdSamples) : NAN;
+
+    f.saturationPct = flyingSamples ? 100.f * saturatedSamples / flyingSamples : NAN;
+
+    f.rollSettleSec = NAN;
+    f.rollOvershootPct = NAN;
+
+    if (f.crashed || roll.size() < 10) {
+        return;
+    }
+
+    // Final value is the mean over the last tenth of the step
+    uint32_t tail = roll.size() / 10;
+    double final = 0;
+    for (uint32_t k=roll.size()-tail; k<roll.size(); ++k) {
+        final += roll[k];
+    }
+    final /= tail;
+
+    double peak = 0;
+    uint32_t lastOutside = 0;
+    for (uint32_t k=0; k<roll.size(); ++k) {
+        if (roll[k] * (final > 0 ? 1 : -1) > peak) {
+            peak = roll[k] * (final > 0 ? 1 : -1);
+        }
+        if (fabs(roll[k] - final) > SETTLING_BAND * fabs(final)) {
+            lastOutside = k + 1;
+        }
+    }
+
+    f.rollSettleSec = lastOutside * LOOP_USEC / 1e6f;
+    f.rollOvershootPct = 100 * (peak - fabs(final)) / fabs(final);
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t flights = argc > 1 ? atoi(argv[1]) : 1000;
+    uint32_t threads = argc > 2 ? atoi(argv[2]) : 0;
+    uint32_t seed    = argc > 3 ? atoi(argv[3]) : 0;
+
+    std::vector<flight_t> results(flights);
+
+    hf::WorkStealingPool pool(threads);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    pool.run(flights, [&](uint32_t k) {
+            randomize(results[k], seed + k);
+            fly(results[k], seed + k);
+            });
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("flight,frame,rate_p,rate_d,rate_yaw_p,level_p,alt_vel_p,gyro_noise,wind_speed,gust,"
+            "roll_settle_sec,roll_overshoot_pct,altitude_rms_m,saturation_pct,crashed\n");
+
+    uint32_t crashes = 0;
+
+    for (uint32_t k=0; k<flights; ++k) {
+        flight_t & f = results[k];
+        printf("%u,%s,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.3f,%.3f,%.3f,%.2f,%.4f,%.2f,%d\n",
+                seed + k, FRAMES[f.frame], f.ratePitchRollP, f.ratePitchRollD, f.rateYawP, f.levelP, f.altVelP,
+                f.gyroNoise, f.windSpeed, f.gust, f.rollSettleSec, f.rollOvershootPct, f.altitudeRms,
+                f.saturationPct, f.crashed);
+        crashes += f.crashed;
+    }
+
+    float simulated = flights * (DISARMED_SEC + ARM_SEC + CLIMB_SEC + HOLD_SEC + STEP_SEC);
+
+    fprintf(stderr, "%u flights (%u crashed) on %u threads in %3.3f sec, %u steals; up to %3.0fx real time\n",
+            flights, crashes, pool.threadCount(), wall, pool.steals(), simulated / wall);
+
+    return 0;
+}
@@ -0,0 +1,372 @@
+/*
+   Rigid-body multirotor model for closing the software-in-the-loop control loop:
+   reads the values the mixer writes to SimMotor, and feeds gyrometer,
+   accelerometer, quaternion, and rangefinder values to SimIMU and SimRangefinder
+
+   The model works in the usual aerospace frames: world North-East-Down, body
+   Forward-Right-Down.  Its body rates and attitude quaternion then follow the
+   sign conventions in imu.hpp directly.
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <random>
+
+#include "sitl.hpp"
+
+namespace hf {
+
+    // Motor position as a fraction of arm length (X forward, Y right), and the direction of its
+    // propeller's reaction torque on the body about Z (down, so +1 yaws right)
+    typedef struct {
+
+        float x;
+        float y;
+        int8_t torque;
+
+    } motorGeometry_t;
+
+    // Same motor order as MixerQuadXAP
+    static constexpr float SQRT_HALF = 0.70710678f;
+    static constexpr motorGeometry_t QUADXAP_GEOMETRY[4] = {
+        { +SQRT_HALF, +SQRT_HALF, +1 }, // right front
+        { -SQRT_HALF, -SQRT_HALF, +1 }, // left rear
+        { +SQRT_HALF, -SQRT_HALF, -1 }, // left front
+        { -SQRT_HALF, +SQRT_HALF, -1 }, // right rear
+    };
+
+    // Same motor order as MixerQuadXCF
+    static constexpr motorGeometry_t QUADXCF_GEOMETRY[4] = {
+        { -SQRT_HALF, +SQRT_HALF, -1 }, // right rear
+        { +SQRT_HALF, +SQRT_HALF, +1 }, // right front
+        { -SQRT_HALF, -SQRT_HALF, +1 }, // left rear
+        { +SQRT_HALF, -SQRT_HALF, -1 }, // left front
+    };
+
+    // Same motor order as MixerOctoXAP, whose mixing table puts the motors in coaxial pairs
+    static constexpr motorGeometry_t OCTOXAP_GEOMETRY[8] = {
+        { +SQRT_HALF, +SQRT_HALF, -1 },
+        { -SQRT_HALF, -SQRT_HALF, -1 },
+        { +SQRT_HALF, +SQRT_HALF, +1 },
+        { -SQRT_HALF, +SQRT_HALF, +1 },
+        { +SQRT_HALF, -SQRT_HALF, +1 },
+        { -SQRT_HALF, -SQRT_HALF, +1 },
+        { +SQRT_HALF, -SQRT_HALF, -1 },
+        { -SQRT_HALF, +SQRT_HALF, -1 },
+    };
+
+    // Roughly a 250-class quadcopter
+    typedef struct {
+
+        double mass           = 0.60;    // kg
+        double arm            = 0.125;   // m, center to motor
+        double inertia[3]     = {3.5e-3, 3.5e-3, 6.0e-3}; // kg m^2, about body X, Y, Z
+        double thrustToWeight = 4.0;     // all motors at full speed; 4 hovers at half speed
+        double torqueToThrust = 0.016;   // m, propeller reaction torque per unit thrust
+        double motorTau       = 0.025;   // s, first-order spin-up time constant
+        double linearDrag     = 0.25;    // N per m/s
+        double angularDrag    = 2.0e-3;  // N m per rad/s
+
+        double gyroNoise      = 0;       // rad/s, one standard deviation
+        double accelNoise     = 0;       // g
+        double rangeNoise     = 0;       // m
+
+        double vibration      = 0;       // rad/s, gyro shake from one motor at full speed
+        double vibrationHz    = 500;     // motor rotation rate at full speed
+
+        double wind[3]        = {0, 0, 0}; // m/s, steady, North-East-Down
+        double gust           = 0;       // m/s, one standard deviation of turbulence about the steady wind
+        double gustTau        = 1.0;     // s, correlation time of turbulence
+
+        double rangeMax       = 4.0;     // m, as for the VL53L1X
+        double rangeMaxTilt   = 0.5;     // rad
+
+        unsigned int seed     = 0;       // noise is repeatable for a given seed
+
+    } multirotorParams_t;
+
+    class Multirotor {
+
+        private:
+
+            static constexpr double G = 9.80665;
+
+            // Largest integration step; longer updates are split into substeps
+            static constexpr double MAX_STEP = 250e-6;
+
+            static const uint8_t MAX_MOTORS = 8;
+
+            multirotorParams_t _params;
+
+            const motorGeometry_t * _geometry = NULL;
+            uint8_t _nmotors = 0;
+
+            // Per-motor maximum thrust, N
+            double _maxThrust = 0;
+
+            // Motor commands from the mixer, and the speeds they lag behind, both in [0,1]
+            double _commands[MAX_MOTORS] = {0};
+            double _speeds[MAX_MOTORS] = {0};
+
+            // Motor shaft angles, for vibration
+            double _phases[MAX_MOTORS] = {0};
+
+            // World position and velocity (NED), body-to-world attitude, body rates (FRD)
+            double _pos[3] = {0};
+            double _vel[3] = {0};
+            double _quat[4] = {1, 0, 0, 0};
+            double _rates[3] = {0};
+
+            // World acceleration over the last step, for the accelerometer
+            double _accel[3] = {0};
+
+            bool _onGround = true;
+
+            // Turbulence, m/s, NED
+            double _gust[3] = {0};
+
+            std::mt19937 _rng;
+            std::normal_distribution<double> _noise;
+
+            // Body to world
+            void rotate(const double b[3], double w[3])
+            {
+                double qw = _quat[0], qx = _quat[1], qy = _quat[2], qz = _quat[3];
+
+                w[0] = (1-2*(qy*qy+qz*qz))*b[0] + 2*(qx*qy-qw*qz)*b[1]     + 2*(qx*qz+qw*qy)*b[2];
+                w[1] = 2*(qx*qy+qw*qz)*b[0]     + (1-2*(qx*qx+qz*qz))*b[1] + 2*(qy*qz-qw*qx)*b[2];
+                w[2] = 2*(qx*qz-qw*qy)*b[0]     + 2*(qy*qz+qw*qx)*b[1]     + (1-2*(qx*qx+qy*qy))*b[2];
+            }
+
+            // World to body
+            void unrotate(const double w[3], double b[3])
+            {
+                double qw = _quat[0], qx = _quat[1], qy = _quat[2], qz = _quat[3];
+
+                b[0] = (1-2*(qy*qy+qz*qz))*w[0] + 2*(qx*qy+qw*qz)*w[1]     + 2*(qx*qz-qw*qy)*w[2];
+                b[1] = 2*(qx*qy-qw*qz)*w[0]     + (1-2*(qx*qx+qz*qz))*w[1] + 2*(qy*qz+qw*qx)*w[2];
+                b[2] = 2*(qx*qz+qw*qy)*w[0]     + 2*(qy*qz-qw*qx)*w[1]     + (1-2*(qx*qx+qy*qy))*w[2];
+            }
+
+            double noise(double sigma)
+            {
+                return sigma > 0 ? sigma * _noise(_rng) : 0;
+            }
+
+            void integrate(double dt)
+            {
+                // Motor lag, then thrust and reaction torque proportional to speed squared
+                double thrust = 0;
+                double torque[3] = {0};
+                double alpha = dt / (_params.motorTau + dt);
+
+                for (uint8_t i=0; i<_nmotors; ++i) {
+                    _speeds[i] += alpha * (_commands[i] - _speeds[i]);
+                    _phases[i] = fmod(_phases[i] + 2 * M_PI * _params.vibrationHz * _speeds[i] * dt, 2 * M_PI);
+                    double t = _maxThrust * _speeds[i] * _speeds[i];
+                    thrust += t;
+                    // Thrust acts along -Z, so r x F = (-y T, x T, 0)
+                    torque[0] -= _geometry[i].y * _params.arm * t;
+                    torque[1] += _geometry[i].x * _params.arm * t;
+                    torque[2] += _geometry[i].torque * _params.torqueToThrust * t;
+                }
+
+                // Euler's equations for a diagonal inertia tensor
+                const double * J = _params.inertia;
+                double * w = _rates;
+                double wdot[3] = {
+                    (torque[0] - _params.angularDrag*w[0] - (J[2]-J[1])*w[1]*w[2]) / J[0],
+                    (torque[1] - _params.angularDrag*w[1] - (J[0]-J[2])*w[2]*w[0]) / J[1],
+                    (torque[2] - _params.angularDrag*w[2] - (J[1]-J[0])*w[0]*w[1]) / J[2]
+                };
+
+                // Turbulence as a first-order Gauss-Markov process
+                if (_params.gust > 0) {
+                    double sigma = _params.gust * sqrt(2 * dt / _params.gustTau);
+                    for (uint8_t k=0; k<3; ++k) {
+                        _gust[k] += -_gust[k] * dt / _params.gustTau + noise(sigma);
+                    }
+                }
+
+                // Thrust to world frame, plus gravity and drag on the velocity relative to the air
+                double fb[3] = {0, 0, -thrust};
+                double fw[3] = {0};
+                rotate(fb, fw);
+                for (uint8_t k=0; k<3; ++k) {
+                    double air = _vel[k] - _params.wind[k] - _gust[k];
+                    _accel[k] = (fw[k] - _params.linearDrag*air) / _params.mass;
+                }
+                _accel[2] += G;
+
+                // Resting on the ground until thrust exceeds weight
+                _onGround = _pos[2] >= 0 && _accel[2] >= 0;
+                if (_onGround) {
+                    for (uint8_t k=0; k<3; ++k) {
+                        _accel[k] = 0;
+                        _vel[k] = 0;
+                        _rates[k] = 0;
+                    }
+                    _pos[2] = 0;
+                    return;
+                }
+
+                // Semi-implicit Euler: velocities first, then positions with the new velocities
+                for (uint8_t k=0; k<3; ++k) {
+                    _rates[k] += wdot[k] * dt;
+                    _vel[k] += _accel[k] * dt;
+                    _pos[k] += _vel[k] * dt;
+                }
+
+                // Landing
+                if (_pos[2] > 0) {
+                    _pos[2] = 0;
+                }
+
+                // qdot = q * (0, w) / 2
+                double qw = _quat[0], qx = _quat[1], qy = _quat[2], qz = _quat[3];
+                double h = dt / 2;
+                _quat[0] += h * (-qx*w[0] - qy*w[1] - qz*w[2]);
+                _quat[1] += h * ( qw*w[0] + qy*w[2] - qz*w[1]);
+                _quat[2] += h * ( qw*w[1] - qx*w[2] + qz*w[0]);
+                _quat[3] += h * ( qw*w[2] + qx*w[1] - qy*w[0]);
+
+                double norm = sqrt(_quat[0]*_quat[0] + _quat[1]*_quat[1] + _quat[2]*_quat[2] + _quat[3]*_quat[3]);
+                for (uint8_t k=0; k<4; ++k) {
+                    _quat[k] /= norm;
+                }
+            }
+
+        public:
+
+            Multirotor(const motorGeometry_t * geometry, uint8_t nmotors,
+                    const multirotorParams_t & params=multirotorParams_t())
+                : _params(params), _rng(params.seed), _noise(0, 1)
+            {
+                _geometry = geometry;
+                _nmotors = nmotors < MAX_MOTORS ? nmotors : MAX_MOTORS;
+                _maxThrust = _params.thrustToWeight * _params.mass * G / _nmotors;
+            }
+
+            // Reads the motor values the mixer last wrote
+            void readMotors(SimMotor & motors)
+            {
+                for (uint8_t i=0; i<_nmotors; ++i) {
+                    _commands[i] = motors.getValue(i);
+                }
+            }
+
+            // Advances the model by the given time
+            void update(uint32_t usec)
+            {
+                double dt = usec / 1e6;
+                uint32_t steps = (uint32_t)ceil(dt / MAX_STEP);
+
+                for (uint32_t k=0; k<steps; ++k) {
+                    integrate(dt / steps);
+                }
+            }
+
+            void writeImu(SimIMU & imu)
+            {
+                // Propeller imbalance, crudely: each motor shakes every axis at its rotation rate, with an
+                // amplitude that grows as its speed squared
+                double shake[3] = {0};
+                if (_params.vibration > 0) {
+                    for (uint8_t i=0; i<_nmotors; ++i) {
+                        double amplitude = _params.vibration * _speeds[i] * _speeds[i];
+                        for (uint8_t k=0; k<3; ++k) {
+                            shake[k] += amplitude * sin(_phases[i] + i + 2 * M_PI * k / 3);
+                        }
+                    }
+                }
+
+                imu.setGyrometer(
+                        _rates[0] + shake[0] + noise(_params.gyroNoise),
+                        _rates[1] + shake[1] + noise(_params.gyroNoise),
+                        _rates[2] + shake[2] + noise(_params.gyroNoise));
+
+                imu.setQuaternion(_quat[0], _quat[1], _quat[2], _quat[3]);
+
+                // Accelerometers sense specific force, which the IMU convention negates so that level reads +1g
+                double fw[3] = {_accel[0], _accel[1], _accel[2] - G};
+                double fb[3] = {0};
+                unrotate(fw, fb);
+                imu.setAccelerometer(
+                        -fb[0]/G + noise(_params.accelNoise),
+                        -fb[1]/G + noise(_params.accelNoise),
+                        -fb[2]/G + noise(_params.accelNoise));
+            }
+
+            // Distance along the body's down axis to flat ground
+            void writeRangefinder(SimRangefinder & rangefinder)
+            {
+                double down[3] = {0, 0, 1};
+                double dw[3] = {0};
+                rotate(down, dw);
+
+                double distance = dw[2] > 0 ? -_pos[2] / dw[2] : INFINITY;
+
+                bool valid = dw[2] > cos(_params.rangeMaxTilt) && distance <= _params.rangeMax;
+
+                rangefinder.setDistance(distance + noise(_params.rangeNoise), valid);
+            }
+
+            // Mean motor rotation rate, Hz
+            double getMotorHz(void)
+            {
+                double sum = 0;
+                for (uint8_t i=0; i<_nmotors; ++i) {
+                    sum += _speeds[i];
+                }
+                return _params.vibrationHz * sum / _nmotors;
+            }
+
+            // Meters above the ground
+            double getAltitude(void)
+            {
+                return _pos[2] < 0 ? -_pos[2] : 0;
+            }
+
+            // NED, meters
+            void getPosition(double pos[3])
+            {
+                for (uint8_t k=0; k<3; ++k) {
+                    pos[k] = _pos[k];
+                }
+            }
+
+            // Roll, pitch, yaw in radians, with pitch positive nose-up
+            void getEulerAngles(double angles[3])
+            {
+                double qw = _quat[0], qx = _quat[1], qy = _quat[2], qz = _quat[3];
+
+                angles[0] = atan2(2*(qw*qx+qy*qz), 1-2*(qx*qx+qy*qy));
+                angles[1] = asin(fmax(-1, fmin(+1, 2*(qw*qy-qx*qz))));
+                angles[2] = atan2(2*(qw*qz+qx*qy), 1-2*(qy*qy+qz*qz));
+            }
+
+            bool onGround(void)
+            {
+                return _onGround;
+            }
+
+    }; // class Multirotor
+
+} // namespace hf
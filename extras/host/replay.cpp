@@ -0,0 +1,132 @@
+/*
+   Replays a recording from hackflight_flight through Hackflight, with the same
+   mixer and PID controllers, and reports the motor-write checksum (which
+   matches the recording run's) and the slowest updates, by the recorded time
+   at which they happened.
+
+   Usage: hackflight_replay RECORDING [quad|octo]
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "sitl.hpp"
+#include "replay.hpp"
+#include "boards/realboards/arduino/mock.hpp"
+#include "actuators/mixers/quadxap.hpp"
+#include "actuators/mixers/octoxap.hpp"
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/level.hpp"
+#include "pidcontrollers/althold.hpp"
+
+static constexpr uint8_t  LED_PIN   = 13;
+static constexpr uint32_t LOOP_USEC = 100;  // as in hackflight_flight
+
+static constexpr uint8_t SLOWEST = 10;
+
+typedef struct {
+
+    uint32_t usec;  // virtual
+    double   nsec;  // wall
+
+} update_t;
+
+int main(int argc, char ** argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s RECORDING [quad|octo]\n", argv[0]);
+        return 1;
+    }
+
+    bool octo = argc > 2 && !strcmp(argv[2], "octo");
+
+    hf::Replay replay;
+
+    if (!replay.load(argv[1])) {
+        fprintf(stderr, "Unable to load %s\n", argv[1]);
+        return 1;
+    }
+
+    // Must come first, to put the clock under our control
+    hf::Sitl sitl(LOOP_USEC);
+
+    hf::Hackflight h;
+
+    hf::MockBoard board(LED_PIN);
+
+    hf::ReplayIMU imu(&replay);
+
+    hf::ReplayReceiver rc(&replay);
+
+    hf::ReplayRangefinder rangefinder(&replay);
+
+    hf::MixerQuadXAP quadMixer;
+    hf::MixerOctoXAP octoMixer;
+
+    hf::SimMotor motors(octo ? 8 : 4);
+
+    hf::RatePid ratePid = hf::RatePid(0.05f, 0.00f, 0.00f, 0.10f, 0.01f);
+
+    hf::LevelPid levelPid = hf::LevelPid(0.20f);
+
+    hf::AltitudeHoldPid altholdPid = hf::AltitudeHoldPid(1.00f, 0.15f, 0.01f, 0.05f);
+
+    h.init(&board, &imu, &rc, octo ? (hf::Mixer *)&octoMixer : (hf::Mixer *)&quadMixer, &motors);
+
+    h.addSensor(&rangefinder);
+
+    h.addPidController(&levelPid);
+    h.addPidController(&ratePid);
+    h.addPidController(&altholdPid, 1);
+
+    sitl.begin(&h);
+
+    std::vector<update_t> updates;
+
+    while ((int32_t)(micros() - replay.lastUsec()) <= 0) {
+
+        uint32_t usec = micros();
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        sitl.step();
+
+        double nsec = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        updates.push_back({usec, nsec});
+    }
+
+    printf("Replayed %u records over %3.3f sec in %u updates\n", replay.records(), replay.lastUsec() / 1e6,
+            (uint32_t)updates.size());
+    printf("%u motor writes, checksum %016llx\n", motors.getWrites(), (unsigned long long)motors.getChecksum());
+
+    uint8_t slowest = std::min((size_t)SLOWEST, updates.size());
+
+    std::partial_sort(updates.begin(), updates.begin() + slowest, updates.end(),
+            [](const update_t & a, const update_t & b) { return a.nsec > b.nsec; });
+
+    printf("Slowest updates:\n");
+    for (uint8_t k=0; k<slowest; ++k) {
+        printf("  at %10.6f sec: %8.0f nsec\n", updates[k].usec / 1e6, updates[k].nsec);
+    }
+
+    return 0;
+}
@@ -0,0 +1,332 @@
+/*
+   Host support for recordings made with recorder.hpp: a Recorder that writes
+   to a file, and an IMU, receiver, and rangefinder that play a recording back
+
+   Each replay component hands out its recorded readings in order, each once
+   the clock has reached the time it was recorded.  Stepping Hackflight with
+   the Sitl driver at the loop period of the recording therefore feeds it the
+   same readings on the same updates, and for a recording made in SITL gives
+   bit-identical motor outputs.
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include <Arduino.h>
+
+#include "recorder.hpp"
+#include "imus/softquat.hpp"
+#include "sitl.hpp"
+
+namespace hf {
+
+    class FileRecorder : public Recorder {
+
+        private:
+
+            FILE * _file = NULL;
+
+        protected:
+
+            virtual void write(const uint8_t * bytes, uint8_t count) override
+            {
+                fwrite(bytes, 1, count, _file);
+            }
+
+        public:
+
+            FileRecorder(FILE * file)
+            {
+                _file = file;
+            }
+
+    }; // class FileRecorder
+
+    // A recording, split into one stream per record type
+    class Replay {
+
+        private:
+
+            typedef struct {
+
+                uint32_t usec;
+                float values[8];
+
+            } record_t;
+
+            std::vector<record_t> _streams[Recorder::RECORD_TYPES];
+
+            uint32_t _next[Recorder::RECORD_TYPES] = {0};
+
+            uint32_t _records = 0;
+            uint32_t _lastUsec = 0;
+
+        public:
+
+            // Returns false on a missing, foreign, or truncated file
+            bool load(const char * path)
+            {
+                FILE * file = fopen(path, "rb");
+
+                if (!file) {
+                    return false;
+                }
+
+                uint8_t header[Recorder::HEADER_SIZE] = {0};
+                bool ok = fread(header, 1, Recorder::HEADER_SIZE, file) == Recorder::HEADER_SIZE &&
+                    !memcmp(header, "HFR", 3) && header[3] == Recorder::VERSION;
+
+                int type = 0;
+                while (ok && (type = fgetc(file)) != EOF) {
+
+                    uint8_t size = Recorder::payloadSize(type);
+
+                    record_t record = {};
+                    ok = size > 0 &&
+                        fread(&record.usec, 4, 1, file) == 1 &&
+                        fread(record.values, 1, size, file) == size;
+
+                    if (ok) {
+                        _streams[type].push_back(record);
+                        _lastUsec = record.usec;
+                        _records++;
+                    }
+                }
+
+                fclose(file);
+
+                return ok;
+            }
+
+            // Copies out the next reading of the given type if the clock has reached it
+            bool next(uint8_t type, float * values)
+            {
+                std::vector<record_t> & stream = _streams[type];
+
+                if (_next[type] == stream.size() || (int32_t)(micros() - stream[_next[type]].usec) < 0) {
+                    return false;
+                }
+
+                memcpy(values, stream[_next[type]].values, Recorder::payloadSize(type));
+
+                _next[type]++;
+
+                return true;
+            }
+
+            uint32_t records(void)
+            {
+                return _records;
+            }
+
+            uint32_t records(uint8_t type)
+            {
+                return _streams[type].size();
+            }
+
+            uint32_t lastUsec(void)
+            {
+                return _lastUsec;
+            }
+
+    }; // class Replay
+
+    // Plays back without mounting adjustment, since RecordingIMU records readings before it.  To replay a
+    // recording from an IMU that adjusts, subclass this with the same adjustEulerAngles() and adjustGyrometer().
+    class ReplayIMU : public IMU {
+
+        private:
+
+            Replay * _replay = NULL;
+
+        protected:
+
+            virtual bool getQuaternion(float & qw, float & qx, float & qy, float & qz, uint32_t usec) override
+            {
+                (void)usec;
+
+                float q[4] = {0};
+
+                if (!_replay->next(Recorder::RECORD_QUATERNION, q)) {
+                    return false;
+                }
+
+                qw = q[0];
+                qx = q[1];
+                qy = q[2];
+                qz = q[3];
+
+                return true;
+            }
+
+            virtual bool getGyrometer(float & gx, float & gy, float & gz) override
+            {
+                return next(Recorder::RECORD_GYROMETER, gx, gy, gz);
+            }
+
+            virtual bool getAccelerometer(float & ax, float & ay, float & az) override
+            {
+                return next(Recorder::RECORD_ACCELEROMETER, ax, ay, az);
+            }
+
+            virtual bool getMagnetometer(float & mx, float & my, float & mz) override
+            {
+                return next(Recorder::RECORD_MAGNETOMETER, mx, my, mz);
+            }
+
+            virtual bool getBarometer(float & pressure) override
+            {
+                return _replay->next(Recorder::RECORD_BAROMETER, &pressure);
+            }
+
+            bool next(uint8_t type, float & x, float & y, float & z)
+            {
+                float v[3] = {0};
+
+                if (!_replay->next(type, v)) {
+                    return false;
+                }
+
+                x = v[0];
+                y = v[1];
+                z = v[2];
+
+                return true;
+            }
+
+        public:
+
+            ReplayIMU(Replay * replay)
+            {
+                _replay = replay;
+            }
+
+    }; // class ReplayIMU
+
+    // Plays back a raw recording (see RecordingIMU) through the software estimator, computing the quaternion as a
+    // board without one in hardware would
+    template <typename Estimator=MadgwickQuaternionFilter6DOF, uint8_t DIVISOR=5>
+    class ReplayEstimatorIMU : public SoftwareQuaternionIMU<Estimator, DIVISOR> {
+
+        private:
+
+            Replay * _replay = NULL;
+
+            float _gyro[3] = {0};
+            float _accel[3] = {0, 0, 1};
+
+        protected:
+
+            virtual bool imuReady(void) override
+            {
+                return _replay->next(Recorder::RECORD_GYROMETER, _gyro);
+            }
+
+            virtual void imuReadAccelGyro(float & ax, float & ay, float & az, float & gx, float & gy, float & gz) override
+            {
+                // Recorded with the gyrometer reading, so it is due now too
+                _replay->next(Recorder::RECORD_ACCELEROMETER, _accel);
+
+                ax = _accel[0];
+                ay = _accel[1];
+                az = _accel[2];
+                gx = _gyro[0];
+                gy = _gyro[1];
+                gz = _gyro[2];
+            }
+
+        public:
+
+            ReplayEstimatorIMU(Replay * replay)
+            {
+                _replay = replay;
+            }
+
+    }; // class ReplayEstimatorIMU
+
+    // Needs the channel map and demand scale of the receiver that was recorded
+    class ReplayReceiver : public Receiver {
+
+        private:
+
+            Replay * _replay = NULL;
+
+            float _frame[MAXCHAN] = {0};
+
+            bool _lostSignal = false;
+
+        protected:
+
+            virtual bool gotNewFrame(void) override
+            {
+                return _replay->next(Recorder::RECORD_RECEIVER_FRAME, _frame);
+            }
+
+            virtual void readRawvals(void) override
+            {
+                memcpy(rawvals, _frame, sizeof(rawvals));
+            }
+
+            virtual bool lostSignal(void) override
+            {
+                float lost = 0;
+
+                while (_replay->next(Recorder::RECORD_LOST_SIGNAL, &lost)) {
+                    _lostSignal = lost != 0;
+                }
+
+                return _lostSignal;
+            }
+
+        public:
+
+            ReplayReceiver(Replay * replay, const uint8_t channelMap[6]=SITL_CHANNEL_MAP, float demandScale=1.0)
+                : Receiver(channelMap, demandScale)
+            {
+                _replay = replay;
+            }
+
+    }; // class ReplayReceiver
+
+    class ReplayRangefinder : public Rangefinder {
+
+        private:
+
+            Replay * _replay = NULL;
+
+        protected:
+
+            virtual bool distanceAvailable(float & distance) override
+            {
+                return _replay->next(Recorder::RECORD_RANGEFINDER, &distance);
+            }
+
+        public:
+
+            ReplayRangefinder(Replay * replay)
+            {
+                _replay = replay;
+            }
+
+    }; // class ReplayRangefinder
+
+} // namespace hf
@@ -0,0 +1,89 @@
+/*
+   Flies a scripted ten-minute mission in software-in-the-loop, as fast as the
+   host allows
+
+   Usage: hackflight_sitl [MINUTES]
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <chrono>
+
+#include "sitl.hpp"
+#include "boards/realboards/arduino/mock.hpp"
+#include "actuators/mixers/quadxap.hpp"
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/level.hpp"
+
+static constexpr uint8_t  LED_PIN   = 13;
+static constexpr uint32_t LOOP_USEC = 100;  // typical for a 10 kHz main loop
+
+int main(int argc, char ** argv)
+{
+    float minutes = argc > 1 ? atof(argv[1]) : 10;
+
+    // Must come first, to put the clock under our control
+    hf::Sitl sitl(LOOP_USEC);
+
+    hf::Hackflight h;
+
+    hf::MockBoard board(LED_PIN);
+
+    hf::SimIMU imu;
+
+    hf::SimReceiver rc;
+
+    hf::MixerQuadXAP mixer;
+
+    hf::SimMotor motors;
+
+    hf::RatePid ratePid = hf::RatePid(0.05f, 0.00f, 0.00f, 0.10f, 0.01f); 
+
+    hf::LevelPid levelPid = hf::LevelPid(0.20f);
+
+    h.init(&board, &imu, &rc, &mixer, &motors);
+
+    h.addPidController(&levelPid);
+    h.addPidController(&ratePid);
+
+    sitl.begin(&h);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Throttle down, disarmed; then arm
+    sitl.run(1000000);
+    rc.setChannels(-1, 0, 0, 0, +1, -1);
+    sitl.run(1000000);
+
+    // Hover with a gentle roll/pitch wobble, one second at a time
+    uint32_t seconds = (uint32_t)(60 * minutes);
+    for (uint32_t k=2; k<seconds; ++k) {
+        float t = k / 10.f;
+        rc.setChannels(0, 0.1f*sin(t), 0.1f*cos(t), 0, +1, -1);
+        imu.setGyrometer(0.05f*cos(t), -0.05f*sin(t), 0);
+        sitl.run(1000000);
+    }
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("Flew %u sec in %3.3f sec (%3.0fx real time)\n", seconds, wall, seconds / wall);
+    printf("%u motor writes; final motor values: %3.3f %3.3f %3.3f %3.3f\n", motors.getWrites(), 
+            motors.getValue(0), motors.getValue(1), motors.getValue(2), motors.getValue(3));
+
+    return 0;
+}
@@ -0,0 +1,317 @@
+/*
+   Software-in-the-loop support: simulated IMU, receiver, motors, and rangefinder, and a
+   driver that steps Hackflight on the host shim's virtual clock
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "hackflight.hpp"
+#include "imu.hpp"
+#include "motor.hpp"
+#include "receiver.hpp"
+#include "sensors/rangefinder.hpp"
+
+static constexpr uint8_t SITL_CHANNEL_MAP[6] = {0, 1, 2, 3, 4, 5};
+
+namespace hf {
+
+    // Delivers a new gyro sample at a fixed rate, like a real IMU's data-ready line
+    class SimIMU : public IMU {
+
+        private:
+
+            uint32_t _period = 0;
+            uint32_t _deadline = 0;
+
+            float _gyro[3] = {0};
+            float _quat[4] = {1, 0, 0, 0};
+            float _accel[3] = {0, 0, 1};
+
+        protected:
+
+            virtual bool getGyrometer(float & gx, float & gy, float & gz) override
+            {
+                uint32_t usec = micros();
+
+                if ((int32_t)(usec - _deadline) < 0) {
+                    return false;
+                }
+
+                // Samples missed while the loop was busy are gone, as on a real IMU
+                _deadline = usec + _period - (usec - _deadline) % _period;
+
+                gx = _gyro[0];
+                gy = _gyro[1];
+                gz = _gyro[2];
+
+                return true;
+            }
+
+            virtual bool getQuaternion(float & qw, float & qx, float & qy, float & qz, uint32_t usec) override
+            {
+                (void)usec;
+
+                qw = _quat[0];
+                qx = _quat[1];
+                qy = _quat[2];
+                qz = _quat[3];
+
+                return true;
+            }
+
+            virtual bool getAccelerometer(float & ax, float & ay, float & az) override
+            {
+                ax = _accel[0];
+                ay = _accel[1];
+                az = _accel[2];
+
+                return true;
+            }
+
+        public:
+
+            SimIMU(float gyroHz=1000)
+            {
+                _period = (uint32_t)(1.e6f / gyroHz);
+            }
+
+            void setGyrometer(float gx, float gy, float gz)
+            {
+                _gyro[0] = gx;
+                _gyro[1] = gy;
+                _gyro[2] = gz;
+            }
+
+            void setQuaternion(float qw, float qx, float qy, float qz)
+            {
+                _quat[0] = qw;
+                _quat[1] = qx;
+                _quat[2] = qy;
+                _quat[3] = qz;
+            }
+
+            // In g, using the IMU sign convention
+            void setAccelerometer(float ax, float ay, float az)
+            {
+                _accel[0] = ax;
+                _accel[1] = ay;
+                _accel[2] = az;
+            }
+
+    }; // class SimIMU
+
+    // Delivers frames at a fixed rate, with stick values set by the simulation
+    class SimReceiver : public Receiver {
+
+        private:
+
+            uint32_t _period = 0;
+            uint32_t _deadline = 0;
+
+            float _channels[6] = {-1, 0, 0, 0, -1, -1};
+
+        protected:
+
+            virtual bool gotNewFrame(void) override
+            {
+                uint32_t usec = micros();
+
+                if ((int32_t)(usec - _deadline) < 0) {
+                    return false;
+                }
+
+                _deadline = usec + _period - (usec - _deadline) % _period;
+
+                return true;
+            }
+
+            virtual void readRawvals(void) override
+            {
+                for (uint8_t k=0; k<6; ++k) {
+                    rawvals[k] = _channels[k];
+                }
+            }
+
+        public:
+
+            // Default frame period is DSMX's 11 msec
+            SimReceiver(float frameHz=1000/11.f)
+                : Receiver(SITL_CHANNEL_MAP)
+            {
+                _period = (uint32_t)(1.e6f / frameHz);
+            }
+
+            // All in [-1,+1]
+            void setChannels(float throttle, float roll, float pitch, float yaw, float aux1, float aux2)
+            {
+                _channels[0] = throttle;
+                _channels[1] = roll;
+                _channels[2] = pitch;
+                _channels[3] = yaw;
+                _channels[4] = aux1;
+                _channels[5] = aux2;
+            }
+
+    }; // class SimReceiver
+
+    // Captures the values the mixer sends to the motors
+    class SimMotor : public Motor {
+
+        private:
+
+            float _values[MAX_COUNT] = {0};
+
+            uint32_t _writes = 0;
+
+            // FNV-1a hash of every write, for comparing runs
+            uint64_t _checksum = 14695981039346656037ULL;
+
+            void hash(const void * bytes, size_t count)
+            {
+                for (size_t k=0; k<count; ++k) {
+                    _checksum = (_checksum ^ ((const uint8_t *)bytes)[k]) * 1099511628211ULL;
+                }
+            }
+
+        public:
+
+            SimMotor(uint8_t count=4)
+                : Motor(count)
+            {
+            }
+
+            virtual void write(uint8_t index, float value) override
+            {
+                _values[index] = value;
+                _writes++;
+
+                hash(&index, sizeof(index));
+                hash(&value, sizeof(value));
+            }
+
+            float getValue(uint8_t index)
+            {
+                return _values[index];
+            }
+
+            uint32_t getWrites(void)
+            {
+                return _writes;
+            }
+
+            uint64_t getChecksum(void)
+            {
+                return _checksum;
+            }
+
+    }; // class SimMotor
+
+    // Reports whatever distance the simulation last set, or nothing when it's out of range.  With a rate, it
+    // reports at that rate, as a real rangefinder does; without, on every update.
+    class SimRangefinder : public Rangefinder {
+
+        private:
+
+            uint32_t _period = 0;
+            uint32_t _deadline = 0;
+
+            float _distance = 0;
+            bool  _valid = false;
+
+        protected:
+
+            virtual bool distanceAvailable(float & distance) override
+            {
+                if (_period) {
+
+                    uint32_t usec = micros();
+
+                    if ((int32_t)(usec - _deadline) < 0) {
+                        return false;
+                    }
+
+                    _deadline = usec + _period - (usec - _deadline) % _period;
+                }
+
+                distance = _distance;
+
+                return _valid;
+            }
+
+        public:
+
+            SimRangefinder(float rangeHz=0)
+            {
+                _period = rangeHz > 0 ? (uint32_t)(1.e6f / rangeHz) : 0;
+            }
+
+            // Meters
+            void setDistance(float distance, bool valid=true)
+            {
+                _distance = distance;
+                _valid = valid;
+            }
+
+    }; // class SimRangefinder
+
+    // Steps Hackflight::update() as fast as the host allows, charging each update a fixed time on the
+    // virtual clock.  The timer tasks therefore see the same times as on a board whose loop takes that long.
+    class Sitl {
+
+        private:
+
+            Hackflight * _h = NULL;
+
+            uint32_t _loopUsec = 0;
+
+        public:
+
+            // Call before Hackflight::init(), so that the board's startup delays use the virtual clock too
+            Sitl(uint32_t loopUsec)
+            {
+                _loopUsec = loopUsec;
+
+                hostUseVirtualClock();
+            }
+
+            void begin(Hackflight * h)
+            {
+                _h = h;
+            }
+
+            void step(void)
+            {
+                _h->update();
+
+                hostAdvanceClock(_loopUsec);
+            }
+
+            // Runs until the virtual clock has moved forward by the given time
+            void run(uint32_t usec)
+            {
+                for (uint32_t k=0; k<usec/_loopUsec; ++k) {
+                    step();
+                }
+            }
+
+    }; // class Sitl
+
+} // namespace hf
@@ -0,0 +1,306 @@
+/*
+   Flies the multirotor model through the same take-off twice, once with
+   Hackflight::update() on the simulator's virtual clock and once with
+   DualCore running updateFast() and updateComms() on two threads in real
+   time, and checks that the vehicle arms, stays level, and climbs about as
+   far both ways.  Also checks that a GCS motor test sent over MSP while
+   disarmed reaches the motors from the comms core.
+
+   Usage: hackflight_test_dualcore
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "sitl.hpp"
+#include "multirotor.hpp"
+#include "dualcore.hpp"
+#include "boards/realboards/arduino/mock.hpp"
+#include "actuators/mixers/quadxap.hpp"
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/level.hpp"
+#include "check.hpp"
+
+static constexpr uint8_t  LED_PIN   = 13;
+static constexpr uint32_t LOOP_USEC = 100;   // single-core loop, on the virtual clock
+static constexpr uint32_t STEP_USEC = 1000;  // model step in real time, while the two cores run
+
+static constexpr float DISARMED_SEC = 0.5f;
+static constexpr float ARM_SEC      = 0.5f;
+static constexpr float CLIMB_SEC    = 1.5f;
+
+static constexpr float CLIMB_THROTTLE = 0.2f;
+
+static constexpr float MOTOR_TEST = 0.25f;
+
+// The model runs on the test's thread and Hackflight on one or two others, so the simulated parts take a lock
+static std::mutex partsLock;
+
+class LockedIMU : public hf::SimIMU {
+
+    protected:
+
+        virtual bool getGyrometer(float & gx, float & gy, float & gz) override
+        {
+            std::lock_guard<std::mutex> guard(partsLock);
+            return SimIMU::getGyrometer(gx, gy, gz);
+        }
+
+        virtual bool getQuaternion(float & qw, float & qx, float & qy, float & qz, uint32_t usec) override
+        {
+            std::lock_guard<std::mutex> guard(partsLock);
+            return SimIMU::getQuaternion(qw, qx, qy, qz, usec);
+        }
+
+}; // class LockedIMU
+
+class LockedReceiver : public hf::SimReceiver {
+
+    protected:
+
+        virtual bool gotNewFrame(void) override
+        {
+            std::lock_guard<std::mutex> guard(partsLock);
+            return SimReceiver::gotNewFrame();
+        }
+
+        virtual void readRawvals(void) override
+        {
+            std::lock_guard<std::mutex> guard(partsLock);
+            SimReceiver::readRawvals();
+        }
+
+}; // class LockedReceiver
+
+class LockedMotor : public hf::SimMotor {
+
+    public:
+
+        virtual void write(uint8_t index, float value) override
+        {
+            std::lock_guard<std::mutex> guard(partsLock);
+            SimMotor::write(index, value);
+        }
+
+}; // class LockedMotor
+
+typedef struct {
+
+    float motorTest;   // motor 0 while disarmed, after the MSP motor test
+    bool  armed;       // motors running at the end of the arming segment
+    float altitude;    // m, at the end of the climb
+    float maxTilt;     // degrees, over the climb
+
+} flight_t;
+
+// Sends MSP SET_MOTOR_NORMAL for the four motors
+static void sendMotorTest(float value)
+{
+    const uint8_t SIZE = 16, COMMAND = 215;
+
+    uint8_t frame[6 + SIZE] = {'$', 'M', '<', SIZE, COMMAND};
+
+    uint8_t checksum = SIZE ^ COMMAND;
+
+    for (uint8_t k=0; k<4; ++k) {
+        memcpy(&frame[5 + 4*k], &value, 4);
+    }
+
+    for (uint8_t k=0; k<SIZE; ++k) {
+        checksum ^= frame[5 + k];
+    }
+
+    frame[5 + SIZE] = checksum;
+
+    Serial1.inject(frame, sizeof(frame));
+}
+
+// Single-core flight: each loop costs LOOP_USEC on this thread's virtual clock
+static void flySingle(flight_t & flight)
+{
+    hf::Sitl sitl(LOOP_USEC);
+
+    hf::Hackflight h;
+    hf::MockBoard board(LED_PIN);
+    LockedIMU imu;
+    LockedReceiver rc;
+    hf::MixerQuadXAP mixer;
+    LockedMotor motors;
+    hf::Multirotor vehicle(hf::QUADXAP_GEOMETRY, 4);
+
+    hf::RatePid ratePid = hf::RatePid(0.05f, 0.00f, 0.00f, 0.10f, 0.01f);
+    hf::LevelPid levelPid = hf::LevelPid(0.20f);
+
+    h.init(&board, &imu, &rc, &mixer, &motors);
+    h.addPidController(&levelPid);
+    h.addPidController(&ratePid);
+
+    sitl.begin(&h);
+
+    sendMotorTest(MOTOR_TEST);
+
+    const uint32_t armUsec   = (uint32_t)(1e6f * DISARMED_SEC);
+    const uint32_t climbUsec = armUsec + (uint32_t)(1e6f * ARM_SEC);
+    const uint32_t endUsec   = climbUsec + (uint32_t)(1e6f * CLIMB_SEC);
+
+    flight.maxTilt = 0;
+
+    for (uint32_t usec=0; usec<endUsec; usec+=LOOP_USEC) {
+
+        rc.setChannels(usec < climbUsec ? -1 : CLIMB_THROTTLE, 0, 0, 0, usec < armUsec ? -1 : +1, -1);
+
+        vehicle.writeImu(imu);
+
+        sitl.step();
+
+        vehicle.readMotors(motors);
+        vehicle.update(LOOP_USEC);
+
+        if (usec + LOOP_USEC == armUsec) {
+            flight.motorTest = motors.getValue(0);
+        }
+
+        if (usec + LOOP_USEC == climbUsec) {
+            flight.armed = motors.getValue(0) != MOTOR_TEST;
+        }
+
+        if (usec >= climbUsec) {
+            double angles[3] = {0};
+            vehicle.getEulerAngles(angles);
+            float tilt = (float)(fmax(fabs(angles[0]), fabs(angles[1])) * 180 / M_PI);
+            flight.maxTilt = tilt > flight.maxTilt ? tilt : flight.maxTilt;
+        }
+    }
+
+    flight.altitude = vehicle.getAltitude();
+}
+
+// Dual-core flight: the two cores run flat out on their own threads, while this one steps the model in real time
+static void flyDual(flight_t & flight)
+{
+    hf::Hackflight h;
+    hf::MockBoard board(LED_PIN);
+    LockedIMU imu;
+    LockedReceiver rc;
+    hf::MixerQuadXAP mixer;
+    LockedMotor motors;
+    hf::Multirotor vehicle(hf::QUADXAP_GEOMETRY, 4);
+
+    hf::RatePid ratePid = hf::RatePid(0.05f, 0.00f, 0.00f, 0.10f, 0.01f);
+    hf::LevelPid levelPid = hf::LevelPid(0.20f);
+
+    h.init(&board, &imu, &rc, &mixer, &motors);
+    h.addPidController(&levelPid);
+    h.addPidController(&ratePid);
+
+    sendMotorTest(MOTOR_TEST);
+
+    hf::DualCore dualCore;
+
+    {
+        std::lock_guard<std::mutex> guard(partsLock);
+        vehicle.writeImu(imu);
+    }
+
+    dualCore.begin(&h);
+
+    const uint32_t armUsec   = (uint32_t)(1e6f * DISARMED_SEC);
+    const uint32_t climbUsec = armUsec + (uint32_t)(1e6f * ARM_SEC);
+    const uint32_t endUsec   = climbUsec + (uint32_t)(1e6f * CLIMB_SEC);
+
+    flight.maxTilt = 0;
+
+    bool tested = false;
+    bool checkedArming = false;
+
+    uint32_t start = micros();
+    uint32_t last = start;
+
+    while (true) {
+
+        std::this_thread::sleep_for(std::chrono::microseconds(STEP_USEC));
+
+        uint32_t now = micros();
+        uint32_t usec = now - start;
+
+        if (usec >= endUsec) {
+            break;
+        }
+
+        std::lock_guard<std::mutex> guard(partsLock);
+
+        if (!tested && usec >= armUsec) {
+            flight.motorTest = motors.getValue(0);
+            tested = true;
+        }
+
+        if (!checkedArming && usec >= climbUsec) {
+            flight.armed = motors.getValue(0) != MOTOR_TEST;
+            checkedArming = true;
+        }
+
+        rc.setChannels(usec < climbUsec ? -1 : CLIMB_THROTTLE, 0, 0, 0, usec < armUsec ? -1 : +1, -1);
+
+        vehicle.readMotors(motors);
+        vehicle.update(now - last);
+        vehicle.writeImu(imu);
+
+        last = now;
+
+        if (usec >= climbUsec) {
+            double angles[3] = {0};
+            vehicle.getEulerAngles(angles);
+            float tilt = (float)(fmax(fabs(angles[0]), fabs(angles[1])) * 180 / M_PI);
+            flight.maxTilt = tilt > flight.maxTilt ? tilt : flight.maxTilt;
+        }
+    }
+
+    dualCore.end();
+
+    flight.altitude = vehicle.getAltitude();
+}
+
+int main(void)
+{
+    // On a thread of its own, so that its virtual clock leaves this thread on the real one
+    flight_t single = {};
+    std::thread singleThread(flySingle, std::ref(single));
+    singleThread.join();
+
+    flight_t dual = {};
+    flyDual(dual);
+
+    printf("single core: motor test %.2f, armed %d, altitude %.2f m, max tilt %.2f deg\n",
+            single.motorTest, single.armed, single.altitude, single.maxTilt);
+    printf("dual core:   motor test %.2f, armed %d, altitude %.2f m, max tilt %.2f deg\n",
+            dual.motorTest, dual.armed, dual.altitude, dual.maxTilt);
+
+    check(single.motorTest == MOTOR_TEST && single.armed && single.altitude > 0.5f,
+            "single core runs the motor test, arms, and climbs");
+    check(dual.motorTest == MOTOR_TEST, "dual core runs the motor test from the comms core");
+    check(dual.armed, "dual core arms");
+    check(fabsf(dual.altitude - single.altitude) < 0.25f * single.altitude,
+            "dual core climbs within a quarter of the single-core altitude");
+    check(dual.maxTilt < 5 && single.maxTilt < 5, "both stay within five degrees of level");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,131 @@
+/*
+   Checks that a dynamic notch that has locked onto a startup transient lets
+   go of it once the transient has died away and passes the gyro through,
+   while the notch on a steady resonance stays put
+
+   Usage: hackflight_test_dynamicnotch
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "dynamicnotch.hpp"
+#include "check.hpp"
+
+static constexpr float GYRO_HZ      = 8000;
+static constexpr float RESONANCE_HZ = 200;
+static constexpr float TRANSIENT_HZ = 297;
+static constexpr float Q            = 3;   // DynamicNotch's default
+
+// The transient with the resonance, then the resonance alone
+static constexpr float TRANSIENT_SEC = 0.15f;
+static constexpr float RESONANCE_SEC = 0.6f;
+
+// Time for the notch on the transient to let go: a window of samples for the transient to leave the
+// spectrum, then another without a peak
+static constexpr float RELEASE_SEC = 0.2f;
+
+// At the end, when the filter should be the notch on the resonance alone, and long enough settled on it
+static constexpr float COMPARE_SEC = 0.2f;
+static constexpr float SETTLE_SEC  = 0.05f;
+
+static void sample(uint32_t n, bool transient, float values[3])
+{
+    float t = n / GYRO_HZ;
+
+    for (uint8_t k=0; k<3; ++k) {
+        values[k] = 0.5f * sinf(2 * (float)M_PI * 3 * t + k) + 0.2f * sinf(2 * (float)M_PI * RESONANCE_HZ * t + k);
+        if (transient) {
+            values[k] += 0.4f * sinf(2 * (float)M_PI * TRANSIENT_HZ * t);
+        }
+    }
+}
+
+int main(void)
+{
+    hf::DynamicNotch<> notch(GYRO_HZ);
+
+    // The notch on the resonance alone, for comparison once the other has let go
+    hf::BiquadFilter<3> single;
+
+    const uint32_t transientEnd = (uint32_t)(TRANSIENT_SEC * GYRO_HZ);
+    const uint32_t releaseEnd   = transientEnd + (uint32_t)(RELEASE_SEC * GYRO_HZ);
+    const uint32_t end          = transientEnd + (uint32_t)(RESONANCE_SEC * GYRO_HZ);
+    const uint32_t singleStart  = end - (uint32_t)((COMPARE_SEC + SETTLE_SEC) * GYRO_HZ);
+    const uint32_t compareStart = end - (uint32_t)(COMPARE_SEC * GYRO_HZ);
+
+    bool locked = true;
+    bool released = true;
+    bool held = true;
+    float worst = 0;
+
+    for (uint32_t n=0; n<end; ++n) {
+
+        float values[3] = {0};
+        sample(n, n < transientEnd, values);
+
+        float expected[3] = {values[0], values[1], values[2]};
+
+        notch.apply(values);
+
+        // Both notches on, one on the resonance and one on the transient, as the transient ends
+        if (n == transientEnd - 1) {
+            for (uint8_t a=0; a<3; ++a) {
+                locked = locked &&
+                    fabsf(notch.getCenter(a, 0) - RESONANCE_HZ) < 10 && fabsf(notch.getCenter(a, 1) - TRANSIENT_HZ) < 10;
+            }
+        }
+
+        // From then on, the notch on the resonance stays on it, and the other lets go in time
+        for (uint8_t a=0; a<3; ++a) {
+            if (n >= transientEnd) {
+                held = held && fabsf(notch.getCenter(a, 0) - RESONANCE_HZ) < 10;
+            }
+            if (n >= releaseEnd) {
+                released = released && notch.getCenter(a, 1) == 0;
+            }
+        }
+
+        if (n == singleStart) {
+            for (uint8_t a=0; a<3; ++a) {
+                single.setNotch(a, notch.getCenter(a, 0), GYRO_HZ, Q);
+            }
+        }
+
+        if (n >= singleStart) {
+            single.update(expected);
+        }
+
+        if (n >= compareStart) {
+            for (uint8_t a=0; a<3; ++a) {
+                float error = fabsf(values[a] - expected[a]);
+                worst = error > worst ? error : worst;
+            }
+        }
+    }
+
+    check(locked, "notches lock onto the resonance and the transient");
+    check(held, "notch on the resonance stays on it");
+    check(released, "notch on the transient lets go after it dies away");
+    check(worst < 1e-3f, "and passes the gyro through, leaving the notch on the resonance alone");
+
+    printf("Largest difference from the notch on the resonance alone: %g rad/sec\n", worst);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,160 @@
+/*
+   Checks that a GyroPipeline gives bit for bit what its stages give when
+   applied one after another, dropped samples included, and that an empty
+   pipeline passes every sample through untouched
+
+   Usage: hackflight_test_gyrofilter
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gyrofilter.hpp"
+#include "check.hpp"
+
+static constexpr float    GYRO_HZ = 8000;
+static constexpr uint32_t SAMPLES = 100000;
+
+// Hackflight's gyrometer is the only caller of GyroFilter::apply(); this opens it to the test
+template <typename... Stages>
+class OpenPipeline : public hf::GyroPipeline<Stages...> {
+
+    public:
+
+        OpenPipeline(const Stages & ... stages)
+            : hf::GyroPipeline<Stages...>(stages...)
+        {
+        }
+
+        bool run(float values[3])
+        {
+            return this->apply(values);
+        }
+
+}; // class OpenPipeline
+
+// Body rates with a slow maneuver, a motor resonance, and noise, in rad/sec
+static void sample(uint32_t n, float values[3])
+{
+    static uint32_t seed = 1;
+
+    for (uint8_t k=0; k<3; ++k) {
+        seed = seed * 1664525 + 1013904223;
+        float noise = (seed >> 8) / (float)(1 << 24) - 0.5f;
+        values[k] = 0.5f * sinf(2 * M_PI * 3 * n / GYRO_HZ + k) + 0.2f * sinf(2 * M_PI * 250 * n / GYRO_HZ) + 0.05f * noise;
+    }
+}
+
+int main(void)
+{
+    // Decimate 8 kHz to 2 kHz, then filter: the later stages see only the samples the decimator passes
+    {
+        hf::GyroDecimator<4> decimator;
+        hf::GyroBiquadLowpass lowpass(150, GYRO_HZ/4);
+        hf::GyroNotch notch(250, GYRO_HZ/4, 2);
+        hf::GyroPt1 pt1(300, GYRO_HZ/4);
+        hf::GyroPt2 pt2(400, GYRO_HZ/4);
+
+        OpenPipeline<hf::GyroDecimator<4>, hf::GyroBiquadLowpass, hf::GyroNotch, hf::GyroPt1, hf::GyroPt2>
+            pipeline(decimator, lowpass, notch, pt1, pt2);
+
+        uint32_t kept = 0, mismatches = 0;
+
+        for (uint32_t n=0; n<SAMPLES; ++n) {
+
+            float expected[3] = {0}, actual[3] = {0};
+            sample(n, expected);
+            memcpy(actual, expected, sizeof(actual));
+
+            bool keep = decimator.apply(expected);
+            if (keep) {
+                lowpass.apply(expected);
+                notch.apply(expected);
+                pt1.apply(expected);
+                pt2.apply(expected);
+                kept++;
+            }
+
+            bool piped = pipeline.run(actual);
+
+            mismatches += piped != keep || (keep && memcmp(actual, expected, sizeof(actual)));
+        }
+
+        check(kept == SAMPLES/4, "decimator passes one sample in four");
+        check(mismatches == 0, "decimator then filters: pipeline matches the stages in order");
+    }
+
+    // Filter at 8 kHz, then decimate: every sample reaches the filter, whether or not the decimator passes it
+    {
+        hf::GyroBiquadLowpass lowpass(1000, GYRO_HZ);
+        hf::GyroDecimator<4> decimator;
+
+        OpenPipeline<hf::GyroBiquadLowpass, hf::GyroDecimator<4>> pipeline(lowpass, decimator);
+
+        uint32_t mismatches = 0;
+
+        for (uint32_t n=0; n<SAMPLES; ++n) {
+
+            float expected[3] = {0}, actual[3] = {0};
+            sample(n, expected);
+            memcpy(actual, expected, sizeof(actual));
+
+            lowpass.apply(expected);
+            bool keep = decimator.apply(expected);
+
+            bool piped = pipeline.run(actual);
+
+            mismatches += piped != keep || (keep && memcmp(actual, expected, sizeof(actual)));
+        }
+
+        check(mismatches == 0, "filter then decimator: pipeline matches the stages in order");
+    }
+
+    // An empty pipeline must leave every bit alone, special values included
+    {
+        OpenPipeline<> pipeline;
+
+        uint32_t changed = 0, dropped = 0;
+
+        const float specials[] = {0.f, -0.f, FLT_MIN, FLT_MIN / 4, FLT_MAX, -FLT_MAX, INFINITY, -INFINITY, NAN, -NAN};
+
+        for (uint32_t n=0; n<SAMPLES; ++n) {
+
+            float expected[3] = {0};
+            sample(n, expected);
+
+            if (n < sizeof(specials) / sizeof(float)) {
+                expected[0] = expected[1] = expected[2] = specials[n];
+            }
+
+            float actual[3] = {0};
+            memcpy(actual, expected, sizeof(actual));
+
+            dropped += !pipeline.run(actual);
+            changed += memcmp(actual, expected, sizeof(actual)) != 0;
+        }
+
+        check(dropped == 0, "empty pipeline keeps every sample");
+        check(changed == 0, "empty pipeline passes every sample through bit for bit");
+    }
+
+    return failures ? 1 : 0;
+}
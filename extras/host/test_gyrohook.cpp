@@ -0,0 +1,176 @@
+/*
+   Checks Hackflight::setGyroFilter() end to end in SITL: with a decimating
+   filter, the vehicle state updates only on the samples the filter passes,
+   and in gyro-sync mode the PID controllers run once per passed sample
+
+   Usage: hackflight_test_gyrohook
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+#include "sitl.hpp"
+#include "gyrofilter.hpp"
+#include "boards/realboards/arduino/mock.hpp"
+#include "actuators/mixers/quadxap.hpp"
+#include "check.hpp"
+
+static constexpr uint8_t  LED_PIN   = 13;
+static constexpr uint32_t LOOP_USEC = 100;
+static constexpr float    GYRO_HZ   = 2000;
+static constexpr uint32_t RUN_USEC  = 1000000;
+
+static constexpr uint8_t DECIMATION = 4;
+
+// Numbers its samples 0, 1, 2, ... on the roll axis, so the state tells us which samples reached it
+class RampIMU : public hf::SimIMU {
+
+    private:
+
+        uint32_t _samples = 0;
+
+    protected:
+
+        virtual bool getGyrometer(float & gx, float & gy, float & gz) override
+        {
+            if (!SimIMU::getGyrometer(gx, gy, gz)) {
+                return false;
+            }
+
+            gx = (float)_samples++;
+
+            return true;
+        }
+
+    public:
+
+        RampIMU(void)
+            : SimIMU(GYRO_HZ)
+        {
+        }
+
+        uint32_t samples(void)
+        {
+            return _samples;
+        }
+
+}; // class RampIMU
+
+// Records the roll rate in the state each time the PID task runs it
+class ProbePid : public hf::PidController {
+
+    protected:
+
+        virtual void modifyDemands(hf::state_t * state, hf::demands_t & demands) override
+        {
+            (void)demands;
+
+            rates.push_back(state->angularVel[0]);
+        }
+
+    public:
+
+        std::vector<float> rates;
+
+}; // class ProbePid
+
+typedef struct {
+
+    uint32_t samples;          // from the IMU
+    std::vector<float> rates;  // seen by the PID controller
+
+} run_t;
+
+static void fly(bool gyroSync, hf::GyroFilter * filter, run_t & run)
+{
+    hf::Sitl sitl(LOOP_USEC);
+
+    hf::Hackflight h;
+    hf::MockBoard board(LED_PIN);
+    RampIMU imu;
+    hf::SimReceiver rc;
+    hf::MixerQuadXAP mixer;
+    hf::SimMotor motors;
+
+    ProbePid probe;
+
+    h.init(&board, &imu, &rc, &mixer, &motors);
+    h.addPidController(&probe);
+    h.setGyroSync(gyroSync);
+    h.setGyroFilter(filter);
+
+    sitl.begin(&h);
+    sitl.run(RUN_USEC);
+
+    run.samples = imu.samples();
+    run.rates = probe.rates;
+}
+
+int main(void)
+{
+    // Without a filter, gyro sync runs the PID controllers on every sample, each seen as it came
+    {
+        run_t run;
+        fly(true, NULL, run);
+
+        bool inOrder = run.rates.size() == run.samples;
+        for (uint32_t k=0; inOrder && k<run.rates.size(); ++k) {
+            inOrder = run.rates[k] == k;
+        }
+
+        printf("No filter, gyro sync: %u samples, %u PID updates\n", run.samples, (unsigned)run.rates.size());
+        check(run.samples == (uint32_t)(GYRO_HZ * RUN_USEC / 1e6f), "IMU delivers samples at its rate");
+        check(inOrder, "no filter: PID controllers run on every sample");
+    }
+
+    // With a decimator, gyro sync runs them once per passed sample, on the mean of the samples it passes
+    {
+        hf::GyroPipeline<hf::GyroDecimator<DECIMATION>> decimator((hf::GyroDecimator<DECIMATION>()));
+
+        run_t run;
+        fly(true, &decimator, run);
+
+        bool inOrder = run.rates.size() == run.samples / DECIMATION;
+        for (uint32_t k=0; inOrder && k<run.rates.size(); ++k) {
+            inOrder = run.rates[k] == DECIMATION * k + (DECIMATION - 1) / 2.f;
+        }
+
+        printf("Decimator, gyro sync: %u samples, %u PID updates\n", run.samples, (unsigned)run.rates.size());
+        check(inOrder, "decimator: PID controllers run once per passed sample, on the passed value");
+    }
+
+    // On the PID timer, they see the state only as the passed samples left it
+    {
+        hf::GyroPipeline<hf::GyroDecimator<DECIMATION>> decimator((hf::GyroDecimator<DECIMATION>()));
+
+        run_t run;
+        fly(false, &decimator, run);
+
+        bool passedOnly = !run.rates.empty();
+        for (float rate : run.rates) {
+            passedOnly = passedOnly && (rate == 0 || fmodf(rate - (DECIMATION - 1) / 2.f, DECIMATION) == 0);
+        }
+
+        printf("Decimator, PID timer: %u samples, %u PID updates\n", run.samples, (unsigned)run.rates.size());
+        check(passedOnly, "decimator: state updates only on passed samples");
+    }
+
+    return failures ? 1 : 0;
+}
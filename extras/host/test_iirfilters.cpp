@@ -0,0 +1,146 @@
+/*
+   Checks the frequency response of the IIR filters: unity gain at DC, 3 dB
+   down at the cutoff for the PT1, PT2, and biquad lowpass, and a deep null at
+   the center of the biquad notch, with its -3 dB band where notchQ() puts it
+
+   Usage: hackflight_test_iirfilters
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "iirfilters.hpp"
+#include "check.hpp"
+
+static constexpr float SAMPLE_HZ = 8000;
+static constexpr float CUTOFF_HZ = 100;
+static constexpr float CENTER_HZ = 200;
+static constexpr float LOWER_HZ  = 160;  // lower edge of the notch's -3 dB band
+
+// Long enough for every filter here to settle, and a whole number of periods of each test frequency
+static constexpr uint32_t SETTLE_SAMPLES  = 8000;
+static constexpr uint32_t MEASURE_SAMPLES = 8000;
+
+// The PT filters' RC gain is a discrete approximation, so their -3 dB point is only close to the cutoff; here, with the
+// cutoff at 1/80 of the sample rate, a PT1 is 0.17 dB and a PT2 0.30 dB further down.  The biquads' Q is analog too, so
+// the notch's band edge moves a little with the bilinear transform.
+static constexpr float DC_TOLERANCE_DB     = 0.01f;
+static constexpr float PT_TOLERANCE_DB     = 0.5f;
+static constexpr float BIQUAD_TOLERANCE_DB = 0.05f;
+
+static constexpr float NOTCH_DEPTH_DB = -40;
+
+// Runs a sinusoid (or, at zero Hz, a constant) through every channel, and gets each channel's gain in dB
+template <typename Filter>
+static void gainDb(Filter & filter, float hz, float db[3])
+{
+    double sums[3][2] = {};
+
+    for (uint32_t n=0; n<SETTLE_SAMPLES+MEASURE_SAMPLES; ++n) {
+
+        double phase = 2 * M_PI * hz * n / SAMPLE_HZ;
+
+        float values[3] = {0};
+        for (uint8_t k=0; k<3; ++k) {
+            values[k] = hz > 0 ? (float)sin(phase) : 1;
+        }
+
+        filter.update(values);
+
+        if (n >= SETTLE_SAMPLES) {
+            for (uint8_t k=0; k<3; ++k) {
+                sums[k][0] += values[k] * (hz > 0 ? sin(phase) : 1);
+                sums[k][1] += values[k] * (hz > 0 ? cos(phase) : 0);
+            }
+        }
+    }
+
+    for (uint8_t k=0; k<3; ++k) {
+
+        // Amplitude of the output at the input's frequency, by correlation over whole periods
+        double amplitude = hypot(sums[k][0], sums[k][1]) / MEASURE_SAMPLES * (hz > 0 ? 2 : 1);
+
+        db[k] = (float)(20 * log10(amplitude));
+    }
+}
+
+template <typename Filter>
+static void checkGain(Filter & filter, const char * what, float hz, float expected, float tolerance)
+{
+    float db[3] = {0};
+    gainDb(filter, hz, db);
+
+    printf("%-24s %8.3f %8.3f %8.3f dB\n", what, db[0], db[1], db[2]);
+
+    char message[100] = "";
+    snprintf(message, sizeof(message), "%s within %g dB of %g dB", what, tolerance, expected);
+
+    bool ok = true;
+    for (uint8_t k=0; k<3; ++k) {
+        ok = ok && fabsf(db[k] - expected) < tolerance;
+    }
+
+    check(ok, message);
+}
+
+int main(void)
+{
+    // 20 log10(1/sqrt(2))
+    const float CUTOFF_DB = -3.0103f;
+
+    {
+        hf::Pt1Filter<> pt1;
+        pt1.init(CUTOFF_HZ, SAMPLE_HZ);
+        checkGain(pt1, "PT1 at DC", 0, 0, DC_TOLERANCE_DB);
+        pt1.init(CUTOFF_HZ, SAMPLE_HZ);
+        checkGain(pt1, "PT1 at cutoff", CUTOFF_HZ, CUTOFF_DB, PT_TOLERANCE_DB);
+    }
+
+    {
+        hf::Pt2Filter<> pt2;
+        pt2.init(CUTOFF_HZ, SAMPLE_HZ);
+        checkGain(pt2, "PT2 at DC", 0, 0, DC_TOLERANCE_DB);
+        pt2.init(CUTOFF_HZ, SAMPLE_HZ);
+        checkGain(pt2, "PT2 at cutoff", CUTOFF_HZ, CUTOFF_DB, PT_TOLERANCE_DB);
+    }
+
+    {
+        hf::BiquadFilter<> lowpass;
+        lowpass.initLowpass(CUTOFF_HZ, SAMPLE_HZ);
+        checkGain(lowpass, "Biquad lowpass at DC", 0, 0, DC_TOLERANCE_DB);
+        lowpass.reset();
+        checkGain(lowpass, "Biquad lowpass at cutoff", CUTOFF_HZ, CUTOFF_DB, BIQUAD_TOLERANCE_DB);
+    }
+
+    {
+        hf::BiquadFilter<> notch;
+        notch.initNotch(CENTER_HZ, SAMPLE_HZ, hf::BiquadFilter<>::notchQ(CENTER_HZ, LOWER_HZ));
+        checkGain(notch, "Biquad notch at DC", 0, 0, DC_TOLERANCE_DB);
+        notch.reset();
+        checkGain(notch, "Biquad notch at lower", LOWER_HZ, CUTOFF_DB, BIQUAD_TOLERANCE_DB);
+        notch.reset();
+        float db[3] = {0};
+        gainDb(notch, CENTER_HZ, db);
+        printf("%-24s %8.3f %8.3f %8.3f dB\n", "Biquad notch at center", db[0], db[1], db[2]);
+        check(db[0] < NOTCH_DEPTH_DB && db[1] < NOTCH_DEPTH_DB && db[2] < NOTCH_DEPTH_DB,
+                "Biquad notch at center at least 40 dB down");
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+/*
+   Checks that a sensor attached to a data-ready interrupt is read only after
+   its interrupt fires, and that each sensor's interrupt reaches that sensor
+   and no other, by raising the interrupts from the host shim
+
+   Usage: hackflight_test_interrupts
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sitl.hpp"
+#include "sensors/interrupts.hpp"
+#include "boards/realboards/arduino/mock.hpp"
+#include "actuators/mixers/quadxap.hpp"
+#include "check.hpp"
+
+static constexpr uint8_t  LED_PIN   = 13;
+static constexpr uint32_t LOOP_USEC = 1000;
+
+// Counts how often Hackflight asks it for data
+class CountingSensor : public hf::Sensor {
+
+    protected:
+
+        virtual bool ready(uint32_t usec) override
+        {
+            (void)usec;
+
+            readies++;
+
+            return true;
+        }
+
+        virtual void modifyState(hf::state_t & state, uint32_t usec) override
+        {
+            (void)state;
+            (void)usec;
+        }
+
+    public:
+
+        uint32_t readies = 0;
+
+}; // class CountingSensor
+
+int main(void)
+{
+    hf::Sitl sitl(LOOP_USEC);
+
+    hf::Hackflight h;
+    hf::MockBoard board(LED_PIN);
+    hf::SimIMU imu;
+    hf::SimReceiver rc;
+    hf::MixerQuadXAP mixer;
+    hf::SimMotor motors(4);
+
+    CountingSensor first, second, polled;
+
+    h.init(&board, &imu, &rc, &mixer, &motors);
+    h.addSensor(&first);
+    h.addSensor(&second);
+    h.addSensor(&polled);
+
+    check(hf::SensorInterrupts::attach(&first, 2), "first sensor attached to pin 2");
+    check(hf::SensorInterrupts::attach(&second, 3), "second sensor attached to pin 3");
+
+    sitl.begin(&h);
+
+    sitl.run(100 * LOOP_USEC);
+
+    check(first.readies == 0 && second.readies == 0, "no reads before any interrupt");
+    check(polled.readies > 0, "polled sensor read on every pass");
+
+    hostRaiseInterrupt(digitalPinToInterrupt(2));
+    sitl.step();
+    check(first.readies == 1, "first sensor read once after its interrupt");
+    check(second.readies == 0, "second sensor not read after the first's interrupt");
+
+    sitl.run(100 * LOOP_USEC);
+    check(first.readies == 1, "first sensor not read again until its next interrupt");
+
+    hostRaiseInterrupt(digitalPinToInterrupt(3));
+    hostRaiseInterrupt(digitalPinToInterrupt(3));
+    sitl.run(10 * LOOP_USEC);
+    check(second.readies == 1, "two interrupts before a pass give one read");
+    check(first.readies == 1, "first sensor not read after the second's interrupt");
+
+    CountingSensor third, fourth, fifth;
+    check(hf::SensorInterrupts::attach(&third, 4) && hf::SensorInterrupts::attach(&fourth, 5),
+            "slots for four sensors");
+    check(!hf::SensorInterrupts::attach(&fifth, 6), "fifth sensor refused");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,116 @@
+/*
+   Stress test for the lock-free ring buffer: a producer thread pushes
+   sequence-numbered items while a consumer thread pops them, and every item
+   must come out exactly once, whole, and in order
+
+   Usage: hackflight_test_ringbuffer [ITEMS]
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+
+#include "ringbuffer.hpp"
+
+// Wider than a machine word, so that a torn read shows up as a mismatch between the two halves
+typedef struct {
+
+    uint64_t sequence;
+    uint64_t check;
+
+} item_t;
+
+static uint64_t checkFor(uint64_t sequence)
+{
+    return ~sequence * 0x9e3779b97f4a7c15ull;
+}
+
+template <uint8_t N>
+static bool run(uint32_t items)
+{
+    hf::RingBuffer<item_t, N> buffer;
+
+    std::atomic<bool> done(false);
+
+    // The producer retries when the buffer is full, so every item should get through
+    std::thread producer([&]() {
+            for (uint64_t k=0; k<items; ++k) {
+                item_t item = {k, checkFor(k)};
+                while (!buffer.push(item)) {
+                    std::this_thread::yield();
+                }
+            }
+            done = true;
+        });
+
+    uint64_t received = 0, expected = 0, torn = 0, outOfOrder = 0;
+
+    while (true) {
+
+        // Checked before popping, so that once the producer is done an empty buffer means we have it all
+        bool finished = done;
+
+        item_t item = {};
+
+        // Yielding lets the test run on a single core, at the cost of fewer close races there
+        if (!buffer.pop(item)) {
+            if (finished) {
+                break;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+
+        received++;
+
+        if (item.check != checkFor(item.sequence)) {
+            torn++;
+        }
+
+        // A drop shows up as a skip ahead, a duplicate or reordering as a step back
+        if (item.sequence != expected) {
+            outOfOrder++;
+        }
+
+        expected = item.sequence + 1;
+    }
+
+    producer.join();
+
+    bool ok = received == items && torn == 0 && outOfOrder == 0;
+
+    printf("%s: %lu of %u items through RingBuffer<%u>: %lu torn, %lu out of sequence, %u full on push\n",
+            ok ? "PASS" : "FAIL", (unsigned long)received, items, N, (unsigned long)torn, (unsigned long)outOfOrder,
+            buffer.overruns());
+
+    return ok;
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t items = argc > 1 ? atoi(argv[1]) : 5000000;
+
+    // Small buffers keep the two threads on each other's heels; the largest wraps the byte indices
+    bool ok = run<2>(items);
+    ok = run<8>(items) && ok;
+    ok = run<128>(items) && ok;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+/*
+   Concurrency test for the sequence lock: a writer thread publishes
+   snapshots whose every word holds the same count, while a reader takes them
+   with tryRead() and read().  Every copy the reader ends up with must be
+   whole, whether or not the read succeeded, and counts must never go back.
+
+   Usage: hackflight_test_seqlock [WRITES]
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+
+#include "seqlock.hpp"
+
+// Large, so that a write takes long enough to be caught in the middle
+static const uint16_t WORDS = 1024;
+
+typedef struct {
+
+    uint32_t words[WORDS];
+
+} snapshot_t;
+
+static bool whole(const snapshot_t & s)
+{
+    for (uint16_t k=1; k<WORDS; ++k) {
+        if (s.words[k] != s.words[0]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t writes = argc > 1 ? atoi(argv[1]) : 2000000;
+
+    hf::Seqlock<snapshot_t> seqlock;
+
+    std::atomic<bool> done(false);
+
+    std::thread writer([&]() {
+            snapshot_t s = {};
+            for (uint32_t n=1; n<=writes; ++n) {
+                for (uint16_t k=0; k<WORDS; ++k) {
+                    s.words[k] = n;
+                }
+                seqlock.write(s);
+            }
+            done = true;
+        });
+
+    snapshot_t copy = {};
+
+    uint32_t reads = 0, failedTries = 0, torn = 0, backwards = 0, last = 0;
+
+    while (!done) {
+
+        // Alternate between the two ways of reading; the fast loop uses one and the comms loop the other
+        if (reads & 1) {
+            seqlock.read(copy);
+        }
+        else if (!seqlock.tryRead(copy)) {
+            failedTries++;
+        }
+
+        reads++;
+
+        if (!whole(copy)) {
+            torn++;
+        }
+
+        if (copy.words[0] < last) {
+            backwards++;
+        }
+        last = copy.words[0];
+    }
+
+    writer.join();
+
+    bool ok = torn == 0 && backwards == 0;
+
+    printf("%s: %u reads of %u writes (%u tries failed): %u torn, %u out of order\n",
+            ok ? "PASS" : "FAIL", reads, writes, failedTries, torn, backwards);
+
+    return ok ? 0 : 1;
+}
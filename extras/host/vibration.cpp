@@ -0,0 +1,205 @@
+/*
+   Flies the multirotor model with propeller vibration in its gyro, sweeping
+   the throttle so that the vibration moves with motor speed, once without
+   gyro filtering and once with a dynamic notch.  Prints the motor rotation
+   rate against the notches' centers as it goes, then the motor jitter (RMS
+   change in motor value between updates) of both flights and the cost of the
+   dynamic notch per gyro sample.
+
+   Usage: hackflight_vibration [SECONDS]
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "sitl.hpp"
+#include "multirotor.hpp"
+#include "gyrofilter.hpp"
+#include "dynamicnotch.hpp"
+#include "boards/realboards/arduino/mock.hpp"
+#include "actuators/mixers/quadxap.hpp"
+#include "pidcontrollers/rate.hpp"
+#include "pidcontrollers/level.hpp"
+
+static constexpr uint8_t  LED_PIN     = 13;
+static constexpr uint32_t LOOP_USEC   = 125;
+static constexpr uint32_t REPORT_USEC = 1000000;
+
+// A gyro sample on every loop
+static constexpr float GYRO_HZ = 1e6f / LOOP_USEC;
+
+static constexpr float DISARMED_SEC = 0.5f;
+static constexpr float ARM_SEC      = 0.5f;
+
+// Throttle stick swings about this, with this amplitude and period, taking the motors through roughly
+// 200 to 400 Hz
+static constexpr float SWEEP_CENTER = 0.15f;
+static constexpr float SWEEP_SWING  = 0.35f;
+static constexpr float SWEEP_SEC    = 8;
+
+static constexpr float VIBRATION = 0.5f; // rad/s
+
+typedef hf::DynamicNotch<> notch_t;
+
+// Times each gyro sample through the notch
+class TimedNotch : public hf::GyroFilter {
+
+    private:
+
+        notch_t _notch = notch_t(GYRO_HZ);
+
+    protected:
+
+        virtual bool apply(float values[3]) override
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            bool result = _notch.apply(values);
+
+            double nsec = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+            nsecs.push_back(nsec);
+
+            return result;
+        }
+
+    public:
+
+        std::vector<double> nsecs;
+
+        float getCenter(uint8_t axis, uint8_t notch)
+        {
+            return _notch.getCenter(axis, notch);
+        }
+
+}; // class TimedNotch
+
+// Returns RMS motor jitter
+static double fly(float seconds, TimedNotch * notch)
+{
+    // Must come first, to put the clock under our control
+    hf::Sitl sitl(LOOP_USEC);
+
+    hf::Hackflight h;
+
+    hf::MockBoard board(LED_PIN);
+
+    hf::SimIMU imu(GYRO_HZ);
+
+    hf::SimReceiver rc;
+
+    hf::MixerQuadXAP mixer;
+
+    hf::SimMotor motors(4);
+
+    hf::multirotorParams_t params;
+    params.vibration = VIBRATION;
+
+    hf::Multirotor vehicle(hf::QUADXAP_GEOMETRY, 4, params);
+
+    // Some D, which is what turns gyro vibration into motor noise
+    hf::RatePid ratePid = hf::RatePid(0.05f, 0.00f, 0.01f, 0.10f, 0.01f);
+
+    hf::LevelPid levelPid = hf::LevelPid(0.20f);
+
+    h.init(&board, &imu, &rc, &mixer, &motors);
+
+    h.addPidController(&levelPid);
+    h.addPidController(&ratePid);
+
+    if (notch) {
+        h.setGyroFilter(notch);
+        printf("    time  motor Hz  roll notches (Hz)\n");
+    }
+
+    sitl.begin(&h);
+
+    const uint32_t armUsec   = (uint32_t)(1e6f * DISARMED_SEC);
+    const uint32_t sweepUsec = armUsec + (uint32_t)(1e6f * ARM_SEC);
+    const uint32_t endUsec   = sweepUsec + (uint32_t)(1e6f * seconds);
+
+    float previous[4] = {0};
+    double jitter = 0;
+    uint32_t flying = 0;
+
+    uint32_t report = sweepUsec;
+
+    for (uint32_t usec=0; usec<endUsec; usec+=LOOP_USEC) {
+
+        float throttle = usec < sweepUsec ? -1 :
+            SWEEP_CENTER + SWEEP_SWING * sinf(2 * (float)M_PI * (usec - sweepUsec) / 1e6f / SWEEP_SEC);
+
+        rc.setChannels(throttle, 0, 0, 0, usec < armUsec ? -1 : +1, -1);
+
+        vehicle.writeImu(imu);
+
+        sitl.step();
+
+        vehicle.readMotors(motors);
+        vehicle.update(LOOP_USEC);
+
+        if (usec < sweepUsec) {
+            continue;
+        }
+
+        for (uint8_t i=0; i<4; ++i) {
+            float value = motors.getValue(i);
+            jitter += (value - previous[i]) * (value - previous[i]);
+            previous[i] = value;
+        }
+        flying++;
+
+        if (notch && usec >= report) {
+            printf("%8.1f %9.1f %9.1f %9.1f\n", (usec - sweepUsec)/1e6, vehicle.getMotorHz(),
+                    notch->getCenter(0, 0), notch->getCenter(0, 1));
+            report += REPORT_USEC;
+        }
+    }
+
+    return sqrt(jitter / (4 * flying));
+}
+
+int main(int argc, char ** argv)
+{
+    float seconds = argc > 1 ? atof(argv[1]) : 2 * SWEEP_SEC;
+
+    double unfiltered = fly(seconds, NULL);
+
+    TimedNotch notch;
+
+    double filtered = fly(seconds, &notch);
+
+    printf("Motor jitter, RMS: %.5f unfiltered, %.5f with dynamic notch (%.1f dB)\n",
+            unfiltered, filtered, 20 * log10(filtered / unfiltered));
+
+    // The host's scheduler dominates the very worst times, so we give a high percentile as well
+    std::vector<double> & nsecs = notch.nsecs;
+    double total = 0;
+    for (double nsec : nsecs) {
+        total += nsec;
+    }
+    std::sort(nsecs.begin(), nsecs.end());
+
+    printf("Dynamic notch per gyro sample: %.1f ns mean, %.1f ns 99.9th percentile, %.1f ns max over %u samples\n",
+            total / nsecs.size(), nsecs[nsecs.size() * 999 / 1000], nsecs.back(), (uint32_t)nsecs.size());
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+   Work-stealing thread pool for batches of independent host simulations
+
+   Each worker starts with its own contiguous block of tasks, taken from the
+   back of its queue, and steals from the front of other workers' queues when
+   its own runs dry.  Flights that crash early or hit long transients then
+   don't leave cores idle at the end of a batch.
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hf {
+
+    class WorkStealingPool {
+
+        private:
+
+            typedef struct {
+
+                std::mutex mutex;
+                std::deque<uint32_t> tasks;
+
+            } queue_t;
+
+            std::vector<queue_t> _queues;
+
+            uint32_t _steals = 0;
+            std::mutex _stealsMutex;
+
+            bool popOwn(queue_t & queue, uint32_t & task)
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+
+                if (queue.tasks.empty()) {
+                    return false;
+                }
+
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+
+                return true;
+            }
+
+            bool steal(uint32_t thief, uint32_t & task)
+            {
+                uint32_t n = _queues.size();
+
+                for (uint32_t k=1; k<n; ++k) {
+
+                    queue_t & victim = _queues[(thief + k) % n];
+
+                    std::lock_guard<std::mutex> lock(victim.mutex);
+
+                    if (!victim.tasks.empty()) {
+                        task = victim.tasks.front();
+                        victim.tasks.pop_front();
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            void work(uint32_t index, const std::function<void(uint32_t)> & run)
+            {
+                uint32_t task = 0;
+                uint32_t steals = 0;
+
+                while (true) {
+
+                    if (popOwn(_queues[index], task)) {
+                        run(task);
+                    }
+
+                    // No task ever adds more, so once every queue is empty the batch is done
+                    else if (steal(index, task)) {
+                        steals++;
+                        run(task);
+                    }
+
+                    else {
+                        break;
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(_stealsMutex);
+                _steals += steals;
+            }
+
+        public:
+
+            // Defaults to one worker per core
+            WorkStealingPool(uint32_t threads=0)
+                : _queues(threads ? threads : (std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1))
+            {
+            }
+
+            // Calls run(0) ... run(count-1) across the workers, returning when all have finished.  run() must
+            // be safe to call concurrently for different tasks.
+            void run(uint32_t count, const std::function<void(uint32_t)> & run)
+            {
+                uint32_t n = _queues.size();
+
+                for (uint32_t w=0; w<n; ++w) {
+                    for (uint32_t t=w*count/n; t<(w+1)*count/n; ++t) {
+                        _queues[w].tasks.push_back(t);
+                    }
+                }
+
+                std::vector<std::thread> threads;
+
+                for (uint32_t w=0; w<n; ++w) {
+                    threads.push_back(std::thread(&WorkStealingPool::work, this, w, std::cref(run)));
+                }
+
+                for (std::thread & thread : threads) {
+                    thread.join();
+                }
+            }
+
+            uint32_t threadCount(void)
+            {
+                return _queues.size();
+            }
+
+            // Tasks that ran on a worker other than the one they started on
+            uint32_t steals(void)
+            {
+                return _steals;
+            }
+
+    }; // class WorkStealingPool
+
+} // namespace hf
@@ -30,6 +30,7 @@ namespace hf {
 
         friend class Hackflight;
         friend class SerialTask;
+        template <typename, typename, typename, typename, typename, typename...> friend class StaticHackflight;
 
         private:
 
@@ -63,9 +64,10 @@ namespace hf {
 
         protected:
 
-            Motor * _motors;
+            // StaticHackflight copies its mixer before init(), so every member needs a value by then
+            Motor * _motors = NULL;
 
-            motorMixer_t motorDirections[MAXMOTORS];
+            motorMixer_t motorDirections[MAXMOTORS] = {};
 
             Mixer(uint8_t nmotors)
             {
@@ -82,7 +84,7 @@ namespace hf {
             uint8_t _nmotors;
 
             // This is also use by serial task
-            float  motorsDisarmed[MAXMOTORS];
+            float  motorsDisarmed[MAXMOTORS] = {0};
 
             void useMotors(Motor * motors)
             {
@@ -106,15 +108,12 @@ namespace hf {
                 return Filter::constrainMinMax(value, 0, 1);
             }
 
-            // Actuator overrides ----------------------------------------------
-
-            void run(demands_t demands) override
+            // Computes motor values in [0,1] from demands
+            void mix(demands_t demands, float motorvals[MAXMOTORS])
             {
                 // Map throttle demand from [-1,+1] to [0,1]
                 demands.throttle = (demands.throttle + 1) / 2;
 
-                float motorvals[MAXMOTORS];
-
                 for (uint8_t i = 0; i < _nmotors; i++) {
 
                     motorvals[i] = 
@@ -140,6 +139,15 @@ namespace hf {
                     // Keep motor values in appropriate interval
                     motorvals[i] = constrainMotorValue(i, motorvals[i]);
                 }
+            }
+
+            // Actuator overrides ----------------------------------------------
+
+            void run(demands_t demands) override
+            {
+                float motorvals[MAXMOTORS];
+
+                mix(demands, motorvals);
 
                 for (uint8_t i = 0; i < _nmotors; i++) {
                     safeWriteMotor(i, motorvals[i]);
@@ -32,11 +32,16 @@ namespace hf {
         friend class TimerTask;
         friend class SerialTask;
         friend class PidTask;
+        friend class LoopTimer;
+        friend class Recorder;
+        template <typename, typename, typename, typename, typename, typename...> friend class StaticHackflight;
 
         protected:
 
             //------------------------------------ Core functionality ----------------------------------------------------
-            virtual float getTime(void) = 0;
+
+            // Free-running microsecond counter; callers should compare differences, which are safe across wraparound
+            virtual uint32_t getMicroseconds(void) = 0;
 
             //------------------------------- Serial communications via MSP ----------------------------------------------
             virtual uint8_t serialAvailableBytes(void) { return 0; }
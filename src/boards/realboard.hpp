@@ -28,14 +28,20 @@ namespace hf {
 
     class RealBoard : public Board {
 
+        template <typename, typename, typename, typename, typename, typename...> friend class StaticHackflight;
+
         private:
 
-            static constexpr float   LED_STARTUP_FLASH_SECONDS = 1.0;
-            static constexpr uint8_t LED_STARTUP_FLASH_COUNT   = 20;
-            static constexpr float   LED_SLOWFLASH_SECONDS     = 0.25;
+            static constexpr float    LED_STARTUP_FLASH_SECONDS = 1.0;
+            static constexpr uint8_t  LED_STARTUP_FLASH_COUNT   = 20;
+            static constexpr uint32_t LED_SLOWFLASH_USEC        = 250000;
 
             bool _shouldFlash = false;
 
+            // LED state and time of last toggle, for slow flashing
+            bool _flashState = false;
+            uint32_t _flashUsec = 0;
+
             // Supports MSP over wireless protcols like Bluetooth
             bool _useSerialTelemetry = false;
 
@@ -62,9 +68,9 @@ namespace hf {
                 _shouldFlash = false;
             }
 
-            float getTime(void)
+            uint32_t getMicroseconds(void)
             {
-                return micros() / 1.e6f;
+                return micros();
             }
 
             void delaySeconds(float sec)
@@ -137,15 +143,12 @@ namespace hf {
             {
                 if (shouldflash) {
 
-                    static float _time;
-                    static bool state;
-
-                    float time = getTime();
+                    uint32_t usec = getMicroseconds();
 
-                    if (time-_time > LED_SLOWFLASH_SECONDS) {
-                        state = !state;
-                        setLed(state);
-                        _time = time;
+                    if (usec-_flashUsec > LED_SLOWFLASH_USEC) {
+                        _flashState = !_flashState;
+                        setLed(_flashState);
+                        _flashUsec = usec;
                     }
                 }
 
@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <Arduino.h>
+
 #include "boards/realboard.hpp"
 
 namespace hf {
@@ -81,7 +83,8 @@ namespace hf {
 
     }; // class ArduinoBoard
 
-    void Board::outbuf(char * buf)
+    // Inline, so that sketches and host builds with several source files link once
+    inline void Board::outbuf(char * buf)
     {
         Serial.print(buf);
     }
@@ -20,7 +20,7 @@
 
 #pragma once
 
-#include "boards/realdboards/arduino.hpp"
+#include "boards/realboards/arduino.hpp"
 
 namespace hf {
 
@@ -52,7 +52,6 @@ namespace hf {
 
                 // Set up to receive telemetry over Serial1
                 Serial1.begin(115200);
-                _time = 0;
             }
 
     }; // class MockBoard
@@ -0,0 +1,159 @@
+/*
+   Runs Hackflight on two cores: flight control on one, communications on the other
+
+   On ESP32 (e.g., TinyPICO) the fast loop is pinned to core 1 and the comms
+   loop to core 0; leave the sketch's loop() empty.  Elsewhere (e.g., a host
+   build) the two loops run on their own std::threads.
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "hackflight.hpp"
+
+#ifdef ESP32
+#include <Arduino.h>
+#else
+#include <thread>
+#endif
+
+namespace hf {
+
+    class DualCore {
+
+        private:
+
+            Hackflight * _h = NULL;
+
+            bool _running = false;
+
+            // Loops still running, so end() can wait for them
+            uint8_t _active = 0;
+
+            bool running(void)
+            {
+                return __atomic_load_n(&_running, __ATOMIC_ACQUIRE);
+            }
+
+            void runFast(void)
+            {
+                while (running()) {
+                    _h->updateFast();
+                }
+
+                __atomic_sub_fetch(&_active, 1, __ATOMIC_RELEASE);
+            }
+
+            void runComms(void)
+            {
+                while (running()) {
+                    _h->updateComms();
+                    yield();
+                }
+
+                __atomic_sub_fetch(&_active, 1, __ATOMIC_RELEASE);
+            }
+
+#ifdef ESP32
+
+            // Comms tasks run well below 1 kHz, so we give the rest of core 0 (e.g. DShot) a tick each pass
+            static void yield(void)
+            {
+                vTaskDelay(1);
+            }
+
+            // FreeRTOS tasks must delete themselves rather than return
+            static void fastTask(void * param)
+            {
+                ((DualCore *)param)->runFast();
+                vTaskDelete(NULL);
+            }
+
+            static void commsTask(void * param)
+            {
+                ((DualCore *)param)->runComms();
+                vTaskDelete(NULL);
+            }
+
+            void startLoops(void)
+            {
+                TaskHandle_t fast, comms;
+                xTaskCreatePinnedToCore(fastTask, "HackflightFast", 10000, this, 2, &fast, 1);
+                xTaskCreatePinnedToCore(commsTask, "HackflightComms", 10000, this, 1, &comms, 0);
+            }
+
+            void stopLoops(void)
+            {
+                while (__atomic_load_n(&_active, __ATOMIC_ACQUIRE) > 0) {
+                    vTaskDelay(1);
+                }
+            }
+
+#else
+
+            std::thread _fastThread;
+            std::thread _commsThread;
+
+            static void yield(void)
+            {
+                std::this_thread::yield();
+            }
+
+            void startLoops(void)
+            {
+                _fastThread = std::thread(&DualCore::runFast, this);
+                _commsThread = std::thread(&DualCore::runComms, this);
+            }
+
+            void stopLoops(void)
+            {
+                _fastThread.join();
+                _commsThread.join();
+            }
+
+#endif
+
+        public:
+
+            // Call after Hackflight::init() and after adding sensors and PID controllers
+            void begin(Hackflight * h)
+            {
+                _h = h;
+
+                _h->setDualCore(true);
+
+                _active = 2;
+
+                __atomic_store_n(&_running, true, __ATOMIC_RELEASE);
+
+                startLoops();
+            }
+
+            // Stops both loops and goes back to single-core Hackflight::update()
+            void end(void)
+            {
+                __atomic_store_n(&_running, false, __ATOMIC_RELEASE);
+
+                stopLoops();
+
+                _h->setDualCore(false);
+            }
+
+    }; // class DualCore
+
+} // namespace hf
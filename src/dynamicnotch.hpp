@@ -0,0 +1,343 @@
+/*
+   Dynamic notch filter: follows motor and frame resonances as they move with
+   throttle, and notches them out of the gyro
+
+   A sliding DFT keeps a running spectrum of each gyro axis over the last
+   WINDOW samples, decimated so that the window covers the band of interest,
+   and Hann-windowed in the frequency domain.  The strongest peaks in that
+   band retune a bank of NOTCHES biquad notches per axis; a notch that finds
+   no peak for a whole window goes back to passing everything through, so
+   that one tuned to a transient doesn't stay on it.  The work is spread
+   over loop iterations: each call updates a fixed share of the DFT bins, then
+   does one step of the search-and-retune cycle (one axis's peak search, or
+   one axis's retune), so every call costs about the same.
+
+   DynamicNotch is a GyroPipeline stage; run it at the gyro rate:
+
+       hf::GyroPipeline<hf::DynamicNotch<>> gyroFilter(hf::DynamicNotch<>(8000));
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+#include "iirfilters.hpp"
+
+namespace hf {
+
+    template <uint8_t WINDOW=64, uint8_t NOTCHES=2>
+    class DynamicNotch {
+
+        static_assert(WINDOW >= 8 && WINDOW <= 128, "DynamicNotch window must be 8 to 128 samples");
+        static_assert(NOTCHES > 0, "DynamicNotch needs at least one notch");
+
+        private:
+
+            static const uint8_t BINS = WINDOW / 2;
+
+            // Slightly under one, to keep rounding errors in the sliding DFT from accumulating
+            static constexpr float DAMPING = 0.999f;
+
+            // A peak must have at least this much more power than the average bin
+            static constexpr float PEAK_RATIO = 2;
+
+            // Each retune moves a notch this fraction of the way to its new peak
+            static constexpr float SMOOTHING = 0.3f;
+
+            float _sampleHz = 0;
+            float _q = 0;
+
+            // Analysis runs at the sample rate divided by this
+            uint8_t _decimation = 1;
+
+            float _binHz = 0;
+
+            // Bins in the band of interest
+            uint8_t _lo = 0;
+            uint8_t _hi = 0;
+
+            // Bins the sliding DFT keeps: the band, and two either side for windowing and interpolation
+            uint8_t _first = 0;
+            uint8_t _last = 0;
+
+            // DAMPING * e^(j 2 pi bin / WINDOW), and DAMPING^WINDOW
+            float _twiddleRe[BINS] = {0};
+            float _twiddleIm[BINS] = {0};
+            float _dampingWindow = 0;
+
+            // Decimated samples over the window, per axis
+            float _window[3][WINDOW] = {{0}};
+            uint8_t _windowIdx = 0;
+
+            // The spectrum is meaningless until the window has filled
+            bool _filled = false;
+
+            // Running sum for decimation
+            float _sum[3] = {0};
+            uint8_t _count = 0;
+
+            // Latest decimated sample minus the damped one it replaced, which each bin takes in once
+            float _delta[3] = {0};
+
+            // Spectrum, per axis
+            float _re[3][BINS] = {{0}};
+            float _im[3][BINS] = {{0}};
+
+            // Scratch for peak search
+            float _power[BINS] = {0};
+
+            // Peaks from the last search, and notch centers, in Hz, lowest first; zero for none
+            float _peaks[3][NOTCHES] = {{0}};
+            float _centers[3][NOTCHES] = {{0}};
+
+            // Searches in a row without a peak, per notch, and the number after which a notch lets go: those in
+            // a whole window of new samples
+            uint16_t _misses[3][NOTCHES] = {{0}};
+            uint16_t _maxMisses = 0;
+
+            // Search axes 0,1,2 then retune axes 0,1,2
+            uint8_t _step = 0;
+
+            BiquadFilter<3> _notches[NOTCHES];
+
+            void slide(uint8_t first, uint8_t last)
+            {
+                for (uint8_t a=0; a<3; ++a) {
+                    for (uint8_t b=first; b<last; ++b) {
+                        float re = _re[a][b] + _delta[a];
+                        float im = _im[a][b];
+                        _re[a][b] = re * _twiddleRe[b] - im * _twiddleIm[b];
+                        _im[a][b] = re * _twiddleIm[b] + im * _twiddleRe[b];
+                    }
+                }
+            }
+
+            // Hann-windowed bin: half the bin less a quarter of each neighbor.  For a real signal bin -1 is the
+            // conjugate of bin 1, and we take the Nyquist bin as zero.
+            float hannPower(uint8_t axis, uint8_t b)
+            {
+                float re = 0.5f * _re[axis][b];
+                float im = 0.5f * _im[axis][b];
+
+                if (b > 0) {
+                    re -= 0.25f * _re[axis][b-1];
+                    im -= 0.25f * _im[axis][b-1];
+                }
+                else {
+                    re -= 0.25f * _re[axis][1];
+                    im += 0.25f * _im[axis][1];
+                }
+
+                if (b+1 < BINS) {
+                    re -= 0.25f * _re[axis][b+1];
+                    im -= 0.25f * _im[axis][b+1];
+                }
+
+                return re * re + im * im;
+            }
+
+            void search(uint8_t axis)
+            {
+                // Power in the band, plus one bin either side for interpolation
+                uint8_t plo = _lo - 1;
+                uint8_t phi = _hi + 1 < BINS ? _hi + 1 : _hi;
+
+                float mean = 0;
+                for (uint8_t b=plo; b<=phi; ++b) {
+                    _power[b] = hannPower(axis, b);
+                    if (b >= _lo && b <= _hi) {
+                        mean += _power[b];
+                    }
+                }
+                mean /= _hi - _lo + 1;
+
+                // Strongest local maxima, strongest first
+                uint8_t best[NOTCHES] = {0};
+
+                for (uint8_t b=_lo; b<=_hi; ++b) {
+
+                    float p = _power[b];
+
+                    if (p <= PEAK_RATIO * mean || _power[b-1] >= p || (b < phi && _power[b+1] > p)) {
+                        continue;
+                    }
+
+                    for (uint8_t i=0; i<NOTCHES; ++i) {
+                        if (!best[i] || p > _power[best[i]]) {
+                            for (uint8_t j=NOTCHES-1; j>i; --j) {
+                                best[j] = best[j-1];
+                            }
+                            best[i] = b;
+                            break;
+                        }
+                    }
+                }
+
+                // Lowest first, so that each notch tends to stay with the same resonance
+                for (uint8_t i=1; i<NOTCHES && best[i]; ++i) {
+                    for (uint8_t j=i; j>0 && best[j] < best[j-1]; --j) {
+                        uint8_t tmp = best[j];
+                        best[j] = best[j-1];
+                        best[j-1] = tmp;
+                    }
+                }
+
+                for (uint8_t i=0; i<NOTCHES; ++i) {
+
+                    uint8_t b = best[i];
+
+                    if (!b) {
+                        _peaks[axis][i] = 0;
+                        continue;
+                    }
+
+                    // Fit a parabola through the peak's magnitude and its neighbors'
+                    float y0 = sqrtf(_power[b-1]);
+                    float y1 = sqrtf(_power[b]);
+                    float y2 = b < phi ? sqrtf(_power[b+1]) : y0;
+                    float denom = y0 - 2 * y1 + y2;
+                    float offset = denom != 0 ? 0.5f * (y0 - y2) / denom : 0;
+                    offset = offset < -0.5f ? -0.5f : offset > 0.5f ? 0.5f : offset;
+
+                    _peaks[axis][i] = (b + offset) * _binHz;
+                }
+            }
+
+            void retune(uint8_t axis)
+            {
+                for (uint8_t i=0; i<NOTCHES; ++i) {
+
+                    float peak = _peaks[axis][i];
+
+                    float & center = _centers[axis][i];
+
+                    // With no peak, the notch stays where it was for a while, then passes everything through
+                    if (peak == 0) {
+                        if (center > 0 && ++_misses[axis][i] >= _maxMisses) {
+                            // Cleared state, so the output picks up the input without a step
+                            center = 0;
+                            _notches[i].setNotch(axis, 0, _sampleHz, _q);
+                            _notches[i].reset(axis);
+                        }
+                        continue;
+                    }
+
+                    _misses[axis][i] = 0;
+
+                    center = center > 0 ? center + SMOOTHING * (peak - center) : peak;
+
+                    _notches[i].setNotch(axis, center, _sampleHz, _q);
+                }
+            }
+
+        public:
+
+            DynamicNotch(float sampleHz, float minHz=80, float maxHz=400, float q=3)
+            {
+                _sampleHz = sampleHz;
+                _q = q;
+
+                // Decimate to a bit over twice the top of the band
+                float decimation = sampleHz / (2.5f * maxHz);
+                _decimation = decimation < 1 ? 1 : decimation > 255 ? 255 : (uint8_t)decimation;
+
+                _binHz = sampleHz / _decimation / WINDOW;
+
+                // Bin zero (DC) is never a candidate
+                float lo = roundf(minHz / _binHz);
+                float hi = roundf(maxHz / _binHz);
+                _lo = lo < 1 ? 1 : lo > BINS-1 ? BINS-1 : (uint8_t)lo;
+                _hi = hi < _lo ? _lo : hi > BINS-1 ? BINS-1 : (uint8_t)hi;
+
+                _first = _lo < 2 ? 0 : _lo - 2;
+                _last = _hi + 2 > BINS-1 ? BINS-1 : _hi + 2;
+
+                for (uint8_t b=0; b<BINS; ++b) {
+                    float omega = 2 * (float)M_PI * b / WINDOW;
+                    _twiddleRe[b] = DAMPING * cosf(omega);
+                    _twiddleIm[b] = DAMPING * sinf(omega);
+                }
+
+                _dampingWindow = powf(DAMPING, WINDOW);
+
+                // Each axis is searched once every six calls
+                _maxMisses = (WINDOW * _decimation + 5) / 6;
+
+                // Notches pass everything through until they have a peak to follow
+                for (uint8_t i=0; i<NOTCHES; ++i) {
+                    _notches[i].initNotch(0, sampleHz, q);
+                }
+            }
+
+            bool apply(float values[3])
+            {
+                // Move the spectrum on by this call's share of the bins
+                uint16_t nbins = _last - _first + 1;
+                slide(_first + _count * nbins / _decimation, _first + (_count + 1) * nbins / _decimation);
+
+                for (uint8_t a=0; a<3; ++a) {
+                    _sum[a] += values[a];
+                }
+
+                // Every bin has taken in the last decimated sample, so we can start on the next
+                if (++_count == _decimation) {
+
+                    for (uint8_t a=0; a<3; ++a) {
+                        float x = _sum[a] / _decimation;
+                        _delta[a] = x - _dampingWindow * _window[a][_windowIdx];
+                        _window[a][_windowIdx] = x;
+                        _sum[a] = 0;
+                    }
+
+                    _windowIdx = _windowIdx + 1 == WINDOW ? 0 : _windowIdx + 1;
+
+                    _filled = _filled || _windowIdx == 0;
+
+                    _count = 0;
+                }
+
+                if (_filled) {
+
+                    if (_step < 3) {
+                        search(_step);
+                    }
+                    else {
+                        retune(_step - 3);
+                    }
+
+                    _step = _step + 1 == 6 ? 0 : _step + 1;
+                }
+
+                for (uint8_t i=0; i<NOTCHES; ++i) {
+                    _notches[i].update(values);
+                }
+
+                return true;
+            }
+
+            // Center of a notch in Hz, or zero if it has no peak to follow
+            float getCenter(uint8_t axis, uint8_t notch)
+            {
+                return _centers[axis][notch];
+            }
+
+    }; // class DynamicNotch
+
+} // namespace hf
@@ -0,0 +1,186 @@
+/*
+   Fast approximations to the transcendental functions in the attitude math:
+   atan2, asin, sine and cosine, and reciprocal square root
+
+   Define HACKFLIGHT_FAST_MATH before including Hackflight (or pass
+   -DHACKFLIGHT_FAST_MATH to the compiler; the host build has a CMake option
+   for it) to have atan2(), asin(), sincos(), and rsqrt() use the polynomial
+   kernels.  Otherwise they call the C library, exactly as before.  The
+   kernels themselves are always available as approxAtan2() and so on.
+
+   Worst-case errors over the whole domain (see hackflight_bench_fastmath):
+
+       approxAtan2   3e-7 rad   (minimax odd polynomial on [0,1])
+       approxAsin    3e-7 rad   (minimax odd polynomial on [0,1/2], and an identity beyond)
+       approxSincos  4e-7       (Taylor series on [-pi/2,+pi/2])
+       approxRsqrt   5e-6 relative (bit-level estimate plus two Newton steps; ample for normalizing)
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+namespace hf {
+
+    class FastMath {
+
+        private:
+
+            // Prefixed, since Arduino.h defines PI, HALF_PI, and TWO_PI as macros
+            static constexpr float FM_PI      = 3.14159265f;
+            static constexpr float FM_HALF_PI = 1.57079633f;
+            static constexpr float FM_TWO_PI  = 6.28318531f;
+
+            // 2 pi in two parts, the second holding what the first loses to rounding
+            static constexpr float TWO_PI_HI = 6.28318548f;
+            static constexpr float TWO_PI_LO = -1.74845553e-7f;
+
+            // Odd polynomials fitted for least maximum relative error: arctangent on [0,1], arcsine on [0,1/2]
+
+            static float atanUnit(float z)
+            {
+                float z2 = z * z;
+
+                return z * (0.9999999115f + z2 * (-0.3333209391f + z2 * (0.1997137959f + z2 * (-0.1402944137f +
+                                    z2 * (0.0994281288f + z2 * (-0.05990542978f + z2 * (0.02455760633f +
+                                                z2 * -0.004780585158f)))))));
+            }
+
+            static float asinHalf(float z)
+            {
+                float z2 = z * z;
+
+                return z * (0.9999999955f + z2 * (0.1666679218f + z2 * (0.07494368448f + z2 * (0.04555760679f +
+                                    z2 * (0.02382427985f + z2 * 0.04268980719f)))));
+            }
+
+        public:
+
+#ifdef HACKFLIGHT_FAST_MATH
+            static const bool ENABLED = true;
+#else
+            static const bool ENABLED = false;
+#endif
+
+            static float approxAtan2(float y, float x)
+            {
+                float ax = fabsf(x);
+                float ay = fabsf(y);
+
+                float hi = ax > ay ? ax : ay;
+                float lo = ax > ay ? ay : ax;
+
+                if (hi == 0) {
+                    return 0;
+                }
+
+                float a = atanUnit(lo / hi);
+
+                a = ay > ax ? FM_HALF_PI - a : a;
+                a = x < 0 ? FM_PI - a : a;
+
+                return y < 0 ? -a : a;
+            }
+
+            // Clamps its argument to [-1,+1], where the C library would return NaN for rounding errors beyond
+            static float approxAsin(float x)
+            {
+                float ax = fabsf(x);
+
+                ax = ax > 1 ? 1 : ax;
+
+                // Above 1/2, asin(x) = pi/2 - 2 asin(sqrt((1 - x) / 2)).  Selects rather than branches, as the
+                // compiler can then avoid mispredictions.
+                bool small = ax <= 0.5f;
+                float p = asinHalf(small ? ax : sqrtf(0.5f * (1 - ax)));
+                float a = small ? p : FM_HALF_PI - 2 * p;
+
+                return x < 0 ? -a : a;
+            }
+
+            static void approxSincos(float angle, float & s, float & c)
+            {
+                // Reduce to [-pi,+pi]
+                float turns = angle * (1 / FM_TWO_PI);
+                int32_t n = (int32_t)(turns + (turns < 0 ? -0.5f : 0.5f));
+                float x = (angle - n * TWO_PI_HI) - n * TWO_PI_LO;
+
+                // Then to [-pi/2,+pi/2], using sin(pi - x) = sin(x) and cos(pi - x) = -cos(x)
+                bool reflect = fabsf(x) > FM_HALF_PI;
+                x = reflect ? (x > 0 ? FM_PI : -FM_PI) - x : x;
+
+                float x2 = x * x;
+
+                s = x * (1 + x2 * (-1/6.f + x2 * (1/120.f + x2 * (-1/5040.f + x2 * (1/362880.f +
+                                        x2 * (-1/39916800.f))))));
+
+                c = (reflect ? -1 : 1) * (1 + x2 * (-1/2.f + x2 * (1/24.f + x2 * (-1/720.f + x2 * (1/40320.f +
+                                            x2 * (-1/3628800.f + x2 * (1/479001600.f)))))));
+            }
+
+            // Positive arguments only
+            static float approxRsqrt(float x)
+            {
+                int32_t i = 0;
+                memcpy(&i, &x, 4);
+
+                i = 0x5f375a86 - (i >> 1);
+
+                float y = 0;
+                memcpy(&y, &i, 4);
+
+                float halfx = 0.5f * x;
+
+                y *= 1.5f - halfx * y * y;
+                y *= 1.5f - halfx * y * y;
+
+                return y;
+            }
+
+            static float atan2(float y, float x)
+            {
+                return ENABLED ? approxAtan2(y, x) : atan2f(y, x);
+            }
+
+            static float asin(float x)
+            {
+                return ENABLED ? approxAsin(x) : asinf(x);
+            }
+
+            static void sincos(float angle, float & s, float & c)
+            {
+                if (ENABLED) {
+                    approxSincos(angle, s, c);
+                }
+                else {
+                    s = sinf(angle);
+                    c = cosf(angle);
+                }
+            }
+
+            static float rsqrt(float x)
+            {
+                return ENABLED ? approxRsqrt(x) : 1.0f / sqrtf(x);
+            }
+
+    }; // class FastMath
+
+} // namespace hf
@@ -23,6 +23,8 @@
 #include <math.h>
 #include <stdint.h>
 
+#include "fastmath.hpp"
+
 #ifndef M_PI
 static const float M_PI = 3.141593;
 #endif
@@ -63,25 +65,31 @@ namespace hf {
 
     }; // class Filter
 
+    // History size is a template parameter, so each filter stores only the history it uses
+    template <uint8_t N>
     class LowPassFilter {
 
+        static_assert(N > 1, "LowPassFilter history size must be at least 2");
+
         private:
 
-            float _history[256] = {0};
-            uint8_t _historySize = {0};
+            // Power-of-two sizes wrap the index with a mask, others with a compare; neither needs a divide
+            static constexpr bool POWER_OF_TWO = (N & (N-1)) == 0;
+
+            float _history[N] = {0};
             uint8_t _historyIdx = {0};
             float _sum = {0};
 
-        public:
-
-            LowPassFilter(uint16_t historySize)
+            static uint8_t next(uint8_t index)
             {
-                _historySize = historySize;
+                return POWER_OF_TWO ? (index + 1) & (N-1) : (index + 1 == N ? 0 : index + 1);
             }
 
+        public:
+
             void init(void)
             {
-                for (uint8_t k=0; k<_historySize; ++k) {
+                for (uint8_t k=0; k<N; ++k) {
                     _history[k] = 0;
                 }
                 _historyIdx = 0;
@@ -90,12 +98,22 @@ namespace hf {
 
             float update(float value)
             {
-                uint8_t indexplus1 = (_historyIdx + 1) % _historySize;
+                uint8_t indexplus1 = next(_historyIdx);
                 _history[_historyIdx] = value;
                 _sum += _history[_historyIdx];
                 _sum -= _history[indexplus1];
                 _historyIdx = indexplus1;
-                return _sum / _historySize;
+
+                // The running sum picks up rounding error with every add and subtract, so once per pass
+                // through the history we recompute it from scratch: the sum of all but the oldest entry
+                if (_historyIdx == 0) {
+                    _sum = 0;
+                    for (uint8_t k=1; k<N; ++k) {
+                        _sum += _history[k];
+                    }
+                }
+
+                return _sum / N;
             }
 
     }; // class LowPassFilter
@@ -173,17 +191,17 @@ namespace hf {
                 float q4q4 = q4 * q4;
 
                 // Normalise accelerometer measurement
-                norm = sqrtf(ax * ax + ay * ay + az * az);
+                norm = ax * ax + ay * ay + az * az;
                 if (norm == 0.0f) return; // handle NaN
-                norm = 1.0f/norm;
+                norm = FastMath::rsqrt(norm);
                 ax *= norm;
                 ay *= norm;
                 az *= norm;
 
                 // Normalise magnetometer measurement
-                norm = sqrtf(mx * mx + my * my + mz * mz);
+                norm = mx * mx + my * my + mz * mz;
                 if (norm == 0.0f) return; // handle NaN
-                norm = 1.0f/norm;
+                norm = FastMath::rsqrt(norm);
                 mx *= norm;
                 my *= norm;
                 mz *= norm;
@@ -225,8 +243,7 @@ namespace hf {
                     _2bx * q2 * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
 
                 // Normalize step magnitude
-                norm = sqrtf(s1 * s1 + s2 * s2 + s3 * s3 + s4 * s4);    
-                norm = 1.0f/norm;
+                norm = FastMath::rsqrt(s1 * s1 + s2 * s2 + s3 * s3 + s4 * s4);
                 s1 *= norm;
                 s2 *= norm;
                 s3 *= norm;
@@ -243,8 +260,7 @@ namespace hf {
                 q2 += qDot2 * deltat;
                 q3 += qDot3 * deltat;
                 q4 += qDot4 * deltat;
-                norm = sqrtf(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);    // normalise quaternion
-                norm = 1.0f/norm;
+                norm = FastMath::rsqrt(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);    // normalise quaternion
             }
     }; // class MadgwickQuaternionFilter9DOF 
 
@@ -254,19 +270,27 @@ namespace hf {
 
             float _zeta = 0;
 
-        public:
+            // Gyro bias error
+            float _gbiasx = 0;
+            float _gbiasy = 0;
+            float _gbiasz = 0;
 
-            MadgwickQuaternionFilter6DOF(float beta, float zeta) 
-                : MadgwickQuaternionFilter(beta) 
-            { 
-                _zeta = zeta;
-            }
+            // Samples per chunk in a batch update, small enough for the stack
+            static const uint8_t CHUNK = 32;
 
-            // Adapted from https://github.com/kriswiner/MPU6050/blob/master/quaternionFilter.ino
-            void update(float ax, float ay, float az, float gx, float gy, float gz, float deltat)
+            // Default gyro measurement error and drift, in degrees per second
+            static constexpr float GYRO_MEAS_ERROR_DEG = 20.f;
+            static constexpr float GYRO_MEAS_DRIFT_DEG =  0.f;
+
+            static float gain(float degrees)
             {
-                static float gbiasx, gbiasy, gbiasz;        // gyro bias error
+                return sqrtf(3.0f / 4.0f) * Filter::deg2rad(degrees);
+            }
 
+            // Adapted from https://github.com/kriswiner/MPU6050/blob/master/quaternionFilter.ino, taking a normalized
+            // accelerometer reading
+            void step(float ax, float ay, float az, float gx, float gy, float gz, float deltat)
+            {
                 // Auxiliary variables to avoid repeated arithmetic
                 float _halfq1 = 0.5f * q1;
                 float _halfq2 = 0.5f * q2;
@@ -279,14 +303,6 @@ namespace hf {
                 //float _2q1q3 = 2.0f * q1 * q3;
                 //float _2q3q4 = 2.0f * q3 * q4;
 
-                // Normalise accelerometer measurement
-                float norm = sqrt(ax * ax + ay * ay + az * az);
-                if (norm == 0.0f) return; // handle NaN
-                norm = 1.0f/norm;
-                ax *= norm;
-                ay *= norm;
-                az *= norm;
-
                 // Compute the objective function and Jacobian
                 float f1 = _2q2 * q4 - _2q1 * q3 - ax;
                 float f2 = _2q1 * q2 + _2q3 * q4 - ay;
@@ -304,12 +320,22 @@ namespace hf {
                 float hatDot3 = J_12or23 * f2 - J_33 *f3 - J_13or22 * f1;
                 float hatDot4 = J_14or21 * f1 + J_11or24 * f2;
 
-                // Normalize the gradient
-                norm = sqrt(hatDot1 * hatDot1 + hatDot2 * hatDot2 + hatDot3 * hatDot3 + hatDot4 * hatDot4);
-                hatDot1 /= norm;
-                hatDot2 /= norm;
-                hatDot3 /= norm;
-                hatDot4 /= norm;
+                // Normalize the gradient, dividing as the C library version always has
+                float norm = hatDot1 * hatDot1 + hatDot2 * hatDot2 + hatDot3 * hatDot3 + hatDot4 * hatDot4;
+                if (FastMath::ENABLED) {
+                    norm = FastMath::approxRsqrt(norm);
+                    hatDot1 *= norm;
+                    hatDot2 *= norm;
+                    hatDot3 *= norm;
+                    hatDot4 *= norm;
+                }
+                else {
+                    norm = sqrtf(norm);
+                    hatDot1 /= norm;
+                    hatDot2 /= norm;
+                    hatDot3 /= norm;
+                    hatDot4 /= norm;
+                }
 
                 // Compute estimated gyroscope biases
                 float gerrx = _2q1 * hatDot2 - _2q2 * hatDot1 - _2q3 * hatDot4 + _2q4 * hatDot3;
@@ -317,12 +343,12 @@ namespace hf {
                 float gerrz = _2q1 * hatDot4 - _2q2 * hatDot3 + _2q3 * hatDot2 - _2q4 * hatDot1;
 
                 // Compute and remove gyroscope biases
-                gbiasx += gerrx * deltat * _zeta;
-                gbiasy += gerry * deltat * _zeta;
-                gbiasz += gerrz * deltat * _zeta;
-                gx -= gbiasx;
-                gy -= gbiasy;
-                gz -= gbiasz;
+                _gbiasx += gerrx * deltat * _zeta;
+                _gbiasy += gerry * deltat * _zeta;
+                _gbiasz += gerrz * deltat * _zeta;
+                gx -= _gbiasx;
+                gy -= _gbiasy;
+                gz -= _gbiasz;
 
                 // Compute the quaternion derivative
                 float qDot1 = -_halfq2 * gx - _halfq3 * gy - _halfq4 * gz;
@@ -337,16 +363,226 @@ namespace hf {
                 q4 += (qDot4 -(_beta * hatDot4)) * deltat;
 
                 // Normalize the quaternion
-                norm = sqrt(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);    // normalise quaternion
-                norm = 1.0f/norm;
+                norm = FastMath::rsqrt(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);    // normalise quaternion
                 q1 *= norm;
                 q2 *= norm;
                 q3 *= norm;
                 q4 *= norm;
             }
 
+        public:
+
+            // A block of samples as one array per quantity, for batch updates
+            typedef struct {
+
+                const float * ax;
+                const float * ay;
+                const float * az;
+                const float * gx;
+                const float * gy;
+                const float * gz;
+                const float * deltat;
+
+                uint32_t count;
+
+            } block_t;
+
+            MadgwickQuaternionFilter6DOF(float beta=gain(GYRO_MEAS_ERROR_DEG), float zeta=gain(GYRO_MEAS_DRIFT_DEG)) 
+                : MadgwickQuaternionFilter(beta) 
+            { 
+                _zeta = zeta;
+            }
+
+            void update(float ax, float ay, float az, float gx, float gy, float gz, float deltat)
+            {
+                // Normalise accelerometer measurement
+                float norm = ax * ax + ay * ay + az * az;
+                if (norm == 0.0f) return; // handle NaN
+                norm = FastMath::rsqrt(norm);
+                ax *= norm;
+                ay *= norm;
+                az *= norm;
+
+                step(ax, ay, az, gx, gy, gz, deltat);
+            }
+
+            // Same result as calling update() on each sample in turn, for running the filter offline over a block of
+            // samples (hackflight_bench_filters does).  Replay can't use it, since Hackflight needs each quaternion
+            // before the next gyro reading.  Each chunk's accelerometer readings are normalized first, in a loop with
+            // no dependence between samples that the compiler can vectorize; the filter steps themselves depend on
+            // one another and stay serial.
+            void update(const block_t & block)
+            {
+                float ax[CHUNK], ay[CHUNK], az[CHUNK];
+                float squared[CHUNK];
+
+                for (uint32_t start=0; start<block.count; start+=CHUNK) {
+
+                    uint32_t n = block.count - start < CHUNK ? block.count - start : CHUNK;
+
+                    for (uint32_t k=0; k<n; ++k) {
+                        float x = block.ax[start+k], y = block.ay[start+k], z = block.az[start+k];
+                        squared[k] = x * x + y * y + z * z;
+                        float norm = FastMath::rsqrt(squared[k]);
+                        ax[k] = x * norm;
+                        ay[k] = y * norm;
+                        az[k] = z * norm;
+                    }
+
+                    for (uint32_t k=0; k<n; ++k) {
+                        if (squared[k] != 0.0f) { // handle NaN
+                            step(ax[k], ay[k], az[k], block.gx[start+k], block.gy[start+k], block.gz[start+k],
+                                    block.deltat[start+k]);
+                        }
+                    }
+                }
+            }
+
     }; // class MadgwickQuaternionFilter6DOF
 
+    // Mahony's explicit complementary filter on accelerometer and gyro: the cross product of measured and estimated
+    // gravity is fed back into the gyro rates, proportionally and (with ki > 0) integrally, so that the integral
+    // term tracks gyro bias.  Adapted from the 9DOF version below.
+    class MahonyQuaternionFilter6DOF : public QuaternionFilter {
+
+        private:
+
+            float _kp = 0;
+            float _ki = 0;
+
+            // Integral of the error, which converges on the gyro bias
+            float _eInt[3] = {0};
+
+        public:
+
+            MahonyQuaternionFilter6DOF(float kp=2.0f, float ki=0.0f)
+                : QuaternionFilter()
+            {
+                _kp = kp;
+                _ki = ki;
+            }
+
+            void update(float ax, float ay, float az, float gx, float gy, float gz, float deltat)
+            {
+                // Normalise accelerometer measurement
+                float norm = ax * ax + ay * ay + az * az;
+                if (norm == 0.0f) return; // handle NaN
+                norm = FastMath::rsqrt(norm);
+                ax *= norm;
+                ay *= norm;
+                az *= norm;
+
+                // Estimated direction of gravity
+                float vx = 2.0f * (q2 * q4 - q1 * q3);
+                float vy = 2.0f * (q1 * q2 + q3 * q4);
+                float vz = q1 * q1 - q2 * q2 - q3 * q3 + q4 * q4;
+
+                // Error is cross product between estimated direction and measured direction of gravity
+                float ex = ay * vz - az * vy;
+                float ey = az * vx - ax * vz;
+                float ez = ax * vy - ay * vx;
+
+                if (_ki > 0.0f) {
+                    _eInt[0] += ex * deltat;
+                    _eInt[1] += ey * deltat;
+                    _eInt[2] += ez * deltat;
+                }
+
+                // Apply feedback terms
+                gx += _kp * ex + _ki * _eInt[0];
+                gy += _kp * ey + _ki * _eInt[1];
+                gz += _kp * ez + _ki * _eInt[2];
+
+                // Integrate rate of change of quaternion
+                float halfdt = 0.5f * deltat;
+                float pa = q1, pb = q2, pc = q3, pd = q4;
+                q1 = pa + (-pb * gx - pc * gy - pd * gz) * halfdt;
+                q2 = pb + ( pa * gx + pc * gz - pd * gy) * halfdt;
+                q3 = pc + ( pa * gy - pb * gz + pd * gx) * halfdt;
+                q4 = pd + ( pa * gz + pb * gy - pc * gx) * halfdt;
+
+                // Normalise quaternion
+                norm = FastMath::rsqrt(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);
+                q1 *= norm;
+                q2 *= norm;
+                q3 *= norm;
+                q4 *= norm;
+            }
+
+    }; // class MahonyQuaternionFilter6DOF
+
+    // First-order complementary filter: integrates the gyro, and turns the estimate a fraction deltat / (tau +
+    // deltat) of the way toward the accelerometer's gravity on each update, so that the accelerometer wins below
+    // 1 / (2 pi tau) Hz and the gyro above.  Accelerometer readings further than the tolerance from 1 g are mostly
+    // maneuvering rather than gravity, and are ignored.  The cheapest of the 6DOF estimators: no gyro bias
+    // estimate, and the quaternion is renormalized to first order, as each update moves it only slightly off unit
+    // length.
+    class ComplementaryQuaternionFilter : public QuaternionFilter {
+
+        private:
+
+            float _tau = 0;
+
+            // Bounds on the squared accelerometer magnitude, in g^2
+            float _minSquared = 0;
+            float _maxSquared = 0;
+
+        public:
+
+            ComplementaryQuaternionFilter(float tau=0.5f, float accelTolerance=0.25f)
+                : QuaternionFilter()
+            {
+                _tau = tau;
+                _minSquared = (1 - accelTolerance) * (1 - accelTolerance);
+                _maxSquared = (1 + accelTolerance) * (1 + accelTolerance);
+            }
+
+            void update(float ax, float ay, float az, float gx, float gy, float gz, float deltat)
+            {
+                // Rotation over this update, from the gyro
+                float rx = gx * deltat;
+                float ry = gy * deltat;
+                float rz = gz * deltat;
+
+                float squared = ax * ax + ay * ay + az * az;
+
+                if (squared > _minSquared && squared < _maxSquared) {
+
+                    float norm = FastMath::rsqrt(squared);
+                    ax *= norm;
+                    ay *= norm;
+                    az *= norm;
+
+                    // Estimated direction of gravity
+                    float vx = 2.0f * (q2 * q4 - q1 * q3);
+                    float vy = 2.0f * (q1 * q2 + q3 * q4);
+                    float vz = q1 * q1 - q2 * q2 - q3 * q3 + q4 * q4;
+
+                    // The cross product of measured and estimated gravity is the rotation, for small angles,
+                    // that would take one to the other
+                    float alpha = deltat / (_tau + deltat);
+                    rx += alpha * (ay * vz - az * vy);
+                    ry += alpha * (az * vx - ax * vz);
+                    rz += alpha * (ax * vy - ay * vx);
+                }
+
+                // Integrate
+                float pa = q1, pb = q2, pc = q3, pd = q4;
+                q1 = pa + 0.5f * (-pb * rx - pc * ry - pd * rz);
+                q2 = pb + 0.5f * ( pa * rx + pc * rz - pd * ry);
+                q3 = pc + 0.5f * ( pa * ry - pb * rz + pd * rx);
+                q4 = pd + 0.5f * ( pa * rz + pb * ry - pc * rx);
+
+                // First-order renormalization: 1 / sqrt(n) ~= (3 - n) / 2 for n near 1
+                float norm = 1.5f - 0.5f * (q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);
+                q1 *= norm;
+                q2 *= norm;
+                q3 *= norm;
+                q4 *= norm;
+            }
+
+    }; // class ComplementaryQuaternionFilter
+
     class MahonyQuaternionFilter9DOF : public QuaternionFilter {
 
         private:
@@ -389,17 +625,17 @@ namespace hf {
                 float q4q4 = q4 * q4;   
 
                 // Normalise accelerometer measurement
-                norm = sqrtf(ax * ax + ay * ay + az * az);
+                norm = ax * ax + ay * ay + az * az;
                 if (norm == 0.0f) return; // handle NaN
-                norm = 1.0f / norm;        // use reciprocal for division
+                norm = FastMath::rsqrt(norm);
                 ax *= norm;
                 ay *= norm;
                 az *= norm;
 
                 // Normalise magnetometer measurement
-                norm = sqrtf(mx * mx + my * my + mz * mz);
+                norm = mx * mx + my * my + mz * mz;
                 if (norm == 0.0f) return; // handle NaN
-                norm = 1.0f / norm;        // use reciprocal for division
+                norm = FastMath::rsqrt(norm);
                 mx *= norm;
                 my *= norm;
                 mz *= norm;
@@ -450,8 +686,7 @@ namespace hf {
                 q4 = pc + (q1 * gz + pa * gy - pb * gx) * (0.5f * deltat);
 
                 // Normalise quaternion
-                norm = sqrtf(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);
-                norm = 1.0f / norm;
+                norm = FastMath::rsqrt(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);
                 q1 *= norm;
                 q2 *= norm;
                 q3 *= norm;
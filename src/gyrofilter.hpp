@@ -0,0 +1,236 @@
+/*
+   Gyro prefiltering: lowpass, notch, and decimation stages run on each raw
+   gyrometer sample before it reaches the vehicle state
+
+   The stages of a GyroPipeline are fixed at compile time and held by value,
+   so the compiler can inline the whole chain; Hackflight sees only the
+   GyroFilter base class.  For example, to decimate an 8 kHz gyro to 2 kHz
+   and then filter it:
+
+       hf::GyroPipeline<hf::GyroDecimator<4>, hf::GyroBiquadLowpass, hf::GyroNotch>
+           gyroFilter(hf::GyroDecimator<4>(), hf::GyroBiquadLowpass(150, 2000), hf::GyroNotch(250, 2000, 2));
+
+       h.setGyroFilter(&gyroFilter);
+
+   Each stage runs at the rate of its input, so give stages after a decimator
+   the decimated sample rate.
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "iirfilters.hpp"
+
+namespace hf {
+
+    class GyroFilter {
+
+        friend class Gyrometer;
+
+        protected:
+
+            // Filters the three axes in place; returns false to drop the sample
+            virtual bool apply(float values[3]) = 0;
+
+    }; // class GyroFilter
+
+    // A stage is any class with bool apply(float values[3]), returning false to drop the sample
+
+    class GyroPt1 {
+
+        private:
+
+            Pt1Filter<3> _filter;
+
+        public:
+
+            GyroPt1(float cutoffHz, float sampleHz)
+            {
+                _filter.init(cutoffHz, sampleHz);
+            }
+
+            bool apply(float values[3])
+            {
+                _filter.update(values);
+                return true;
+            }
+
+    }; // class GyroPt1
+
+    class GyroPt2 {
+
+        private:
+
+            Pt2Filter<3> _filter;
+
+        public:
+
+            GyroPt2(float cutoffHz, float sampleHz)
+            {
+                _filter.init(cutoffHz, sampleHz);
+            }
+
+            bool apply(float values[3])
+            {
+                _filter.update(values);
+                return true;
+            }
+
+    }; // class GyroPt2
+
+    class GyroBiquadLowpass {
+
+        private:
+
+            BiquadFilter<3> _filter;
+
+        public:
+
+            GyroBiquadLowpass(float cutoffHz, float sampleHz, float q=BiquadFilter<3>::BUTTERWORTH_Q)
+            {
+                _filter.initLowpass(cutoffHz, sampleHz, q);
+            }
+
+            bool apply(float values[3])
+            {
+                _filter.update(values);
+                return true;
+            }
+
+    }; // class GyroBiquadLowpass
+
+    class GyroNotch {
+
+        private:
+
+            BiquadFilter<3> _filter;
+
+        public:
+
+            GyroNotch(float centerHz, float sampleHz, float q)
+            {
+                _filter.initNotch(centerHz, sampleHz, q);
+            }
+
+            bool apply(float values[3])
+            {
+                _filter.update(values);
+                return true;
+            }
+
+    }; // class GyroNotch
+
+    // Passes the mean of every M samples, which doubles as a crude anti-aliasing filter
+    template <uint8_t M>
+    class GyroDecimator {
+
+        static_assert(M > 0, "GyroDecimator needs a factor of at least one");
+
+        private:
+
+            float _sum[3] = {0};
+            uint8_t _count = 0;
+
+        public:
+
+            bool apply(float values[3])
+            {
+                for (uint8_t k=0; k<3; ++k) {
+                    _sum[k] += values[k];
+                }
+
+                if (++_count < M) {
+                    return false;
+                }
+
+                for (uint8_t k=0; k<3; ++k) {
+                    values[k] = _sum[k] / M;
+                    _sum[k] = 0;
+                }
+
+                _count = 0;
+
+                return true;
+            }
+
+    }; // class GyroDecimator
+
+    // Compile-time list of stages, run in the order given until one drops the sample
+    template <typename... Stages>
+    class GyroStages {
+
+        public:
+
+            bool apply(float values[3])
+            {
+                (void)values;
+
+                return true;
+            }
+
+    }; // class GyroStages
+
+    template <typename Stage, typename... Stages>
+    class GyroStages<Stage, Stages...> {
+
+        private:
+
+            Stage _stage;
+
+            GyroStages<Stages...> _rest;
+
+        public:
+
+            GyroStages(const Stage & stage, const Stages & ... stages)
+                : _stage(stage), _rest(stages...)
+            {
+            }
+
+            bool apply(float values[3])
+            {
+                return _stage.apply(values) && _rest.apply(values);
+            }
+
+    }; // class GyroStages
+
+    template <typename... Stages>
+    class GyroPipeline : public GyroFilter {
+
+        private:
+
+            GyroStages<Stages...> _stages;
+
+        protected:
+
+            virtual bool apply(float values[3]) override
+            {
+                return _stages.apply(values);
+            }
+
+        public:
+
+            GyroPipeline(const Stages & ... stages)
+                : _stages(stages...)
+            {
+            }
+
+    }; // class GyroPipeline
+
+} // namespace hf
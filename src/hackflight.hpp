@@ -21,6 +21,9 @@
 #pragma once
 
 #include "debugger.hpp"
+#include "looptimer.hpp"
+#include "scheduler.hpp"
+#include "seqlock.hpp"
 #include "mspparser.hpp"
 #include "imu.hpp"
 #include "board.hpp"
@@ -37,35 +40,88 @@
 #include "sensors/surfacemount/gyrometer.hpp"
 #include "sensors/surfacemount/quaternion.hpp"
 
+// Room for optional sensors; define this before including Hackflight if your build adds more
+#ifndef HACKFLIGHT_MAX_SENSORS
+#define HACKFLIGHT_MAX_SENSORS 8
+#endif
+
 namespace hf {
 
     class Hackflight {
 
+        public:
+
+            static constexpr uint8_t MAX_SENSORS = HACKFLIGHT_MAX_SENSORS;
+
         private:
 
             static constexpr float MAX_ARMING_ANGLE_DEGREES = 25.0f;
 
+            // Each optional sensor gets its own loop-timing stage
+            static_assert(MAX_SENSORS <= LoopTimer::MAX_STAGES - LoopTimer::STAGE_SENSORS,
+                    "Too many sensors for loop timer");
+
             // Supports periodic ad-hoc debugging
             Debugger _debugger;
 
+            // Timing statistics for each stage of the update loop
+            LoopTimer _loopTimer;
+
             // Mixer or receiver proxy
             Actuator * _actuator = NULL;
 
             RXProxy * _proxy = NULL;
 
             // Sensors 
-            Sensor * _sensors[256] = {NULL};
+            Sensor * _sensors[MAX_SENSORS] = {NULL};
             uint8_t _sensor_count = 0;
 
             // Safety
             bool _safeToArm = false;
 
+            // Set when a sensor or PID controller didn't fit; we then refuse to arm, rather than fly without it
+            bool _overCapacity = false;
+
             // Support for headless mode
             float _yawInitial = 0;
 
             // Timer task for PID controllers
             PidTask _pidTask;
 
+            // Runs the PID and serial tasks, along with any added by addTask()
+            Scheduler _scheduler;
+
+            static const uint8_t PRIORITY_PID    = 200;
+            static const uint8_t PRIORITY_SERIAL = 100;
+
+            // When true, each new gyro sample runs the PID controllers directly
+            // instead of waiting for the PID timer task
+            bool _gyroSync = false;
+
+            // Dual-core mode: updateFast() and updateComms() run concurrently and
+            // exchange snapshots instead of sharing state
+            typedef struct {
+
+                PidTask::command_t command;
+                bool armed;
+                bool failsafe;
+                uint8_t loopTimingStage; // for the MSP LOOP_TIMING request
+                float motorsDisarmed[SerialTask::MSP_MOTORS]; // motor testing from the GCS
+
+            } commsOutput_t;
+
+            bool _dualCore = false;
+
+            Seqlock<state_t> _stateSnapshot;             // fast => comms
+            Seqlock<commsOutput_t> _commsOutputSnapshot; // comms => fast
+
+            Seqlock<LoopTimer::stageSnapshot_t> _loopTimingSnapshot; // fast => comms
+
+            commsOutput_t _commsOutput = {}; // fast core's latest copy
+            state_t _commsState = {};        // comms core's view of the vehicle state
+
+            float _commsMotorsDisarmed[SerialTask::MSP_MOTORS] = {0}; // comms core's motor-test values
+
             // Passed to Hackflight::init() for a particular build
             IMU        * _imu      = NULL;
             Mixer      * _mixer    = NULL;
@@ -77,35 +133,47 @@ namespace hf {
             Gyrometer _gyrometer;
             Quaternion _quaternion; // not really a sensor, but we treat it like one!
  
-            bool safeAngle(uint8_t axis)
+            bool safeAngle(state_t & state, uint8_t axis)
             {
-                return fabs(_state.rotation[axis]) < Filter::deg2rad(MAX_ARMING_ANGLE_DEGREES);
+                return fabs(state.rotation[axis]) < Filter::deg2rad(MAX_ARMING_ANGLE_DEGREES);
+            }
+
+            void cutMotors(void)
+            {
+                // In dual-core mode the fast core cuts the motors when it sees the new arming state
+                if (!_dualCore) {
+                    _actuator->cut();
+                }
             }
 
            void checkQuaternion(void)
             {
                 // Some quaternion filters may need to know the current time
-                float time = _board->getTime();
+                uint32_t usec = _board->getMicroseconds();
 
                 // If quaternion data ready
-                if (_quaternion.ready(time)) {
+                if (_quaternion.ready(usec)) {
 
                     // Update state with new quaternion to yield Euler angles
-                    _quaternion.modifyState(_state, time);
+                    _quaternion.modifyState(_state, usec);
                 }
             }
 
-            void checkGyrometer(void)
+            bool checkGyrometer(void)
             {
                 // Some gyrometers may need to know the current time
-                float time = _board->getTime();
+                uint32_t usec = _board->getMicroseconds();
 
                 // If gyrometer data ready
-                if (_gyrometer.ready(time)) {
+                if (_gyrometer.ready(usec)) {
 
                     // Update state with gyro rates
-                    _gyrometer.modifyState(_state, time);
+                    _gyrometer.modifyState(_state, usec);
+
+                    return true;
                 }
+
+                return false;
             }
 
 
@@ -119,23 +187,38 @@ namespace hf {
             {
                 for (uint8_t k=0; k<_sensor_count; ++k) {
                     Sensor * sensor = _sensors[k];
-                    float time = _board->getTime();
-                    if (sensor->ready(time)) {
-                        sensor->modifyState(_state, time);
+                    // Skip interrupt-driven sensors with nothing new, avoiding a bus transaction in ready()
+                    if (sensor->_interruptDriven && !sensor->checkDataReady()) {
+                        continue;
+                    }
+                    uint32_t usec = _board->getMicroseconds();
+                    if (sensor->ready(usec)) {
+                        sensor->modifyState(_state, usec);
                     }
+                    _loopTimer.lap(LoopTimer::STAGE_SENSORS + k);
                 }
             }
 
-            void add_sensor(Sensor * sensor)
+            bool add_sensor(Sensor * sensor)
             {
+                if (_sensor_count == MAX_SENSORS) {
+                    Debugger::printf("Too many sensors; define HACKFLIGHT_MAX_SENSORS higher.  Will not arm.\n");
+                    _overCapacity = true;
+                    return false;
+                }
+
                 _sensors[_sensor_count++] = sensor;
+
+                _loopTimer.addSensorStage();
+
+                return true;
             }
 
-            void add_sensor(SurfaceMountSensor * sensor, IMU * imu) 
+            bool add_sensor(SurfaceMountSensor * sensor, IMU * imu) 
             {
-                add_sensor(sensor);
-
                 sensor->imu = imu;
+
+                return add_sensor(sensor);
             }
 
             void general_init(Board * board, Receiver * receiver, Actuator * actuator)
@@ -148,6 +231,9 @@ namespace hf {
                 // Ad-hoc debugging support
                 _debugger.init(board);
 
+                // Loop timing support
+                _loopTimer.init(board);
+
                 // Support adding new sensors and PID controllers
                 _sensor_count = 0;
 
@@ -162,25 +248,34 @@ namespace hf {
 
                 // Initialize timer task for PID controllers
                 _pidTask.init(_board, _receiver, _actuator, &_state);
+
+                // Initialize the scheduler with the PID task
+                _scheduler.init(&_loopTimer);
+                _scheduler.add(&_pidTask, PRIORITY_PID, LoopTimer::STAGE_PID);
             }
 
-            void checkReceiver(void)
+            void checkReceiver(state_t & state)
             {
+                // Also catches arming by the simulator or over MSP
+                if (_overCapacity) {
+                    state.armed = false;
+                }
+
                 // Sync failsafe to receiver
-                if (_receiver->lostSignal() && _state.armed) {
-                    _actuator->cut();
-                    _state.armed = false;
-                    _state.failsafe = true;
+                if (_receiver->lostSignal() && state.armed) {
+                    cutMotors();
+                    state.armed = false;
+                    state.failsafe = true;
                     _board->showArmedStatus(false);
                     return;
                 }
 
                 // Check whether receiver data is available
-                if (!_receiver->getDemands(_state.rotation[AXIS_YAW] - _yawInitial)) return;
+                if (!_receiver->getDemands(state.rotation[AXIS_YAW] - _yawInitial)) return;
 
                 // Disarm
-                if (_state.armed && !_receiver->getAux1State()) {
-                    _state.armed = false;
+                if (state.armed && !_receiver->getAux1State()) {
+                    state.armed = false;
                 } 
 
                 // Avoid arming if aux1 switch down on startup
@@ -189,19 +284,19 @@ namespace hf {
                 }
 
                 // Arm (after lots of safety checks!)
-                if (_safeToArm && !_state.armed && _receiver->throttleIsDown() && _receiver->getAux1State() && 
-                        !_state.failsafe && safeAngle(AXIS_ROLL) && safeAngle(AXIS_PITCH)) {
-                    _state.armed = true;
-                    _yawInitial = _state.rotation[AXIS_YAW]; // grab yaw for headless mode
+                if (_safeToArm && !_overCapacity && !state.armed && _receiver->throttleIsDown() && _receiver->getAux1State() && 
+                        !state.failsafe && safeAngle(state, AXIS_ROLL) && safeAngle(state, AXIS_PITCH)) {
+                    state.armed = true;
+                    _yawInitial = state.rotation[AXIS_YAW]; // grab yaw for headless mode
                 }
 
                 // Cut motors on throttle-down
-                if (_state.armed && _receiver->throttleIsDown()) {
-                    _actuator->cut();
+                if (state.armed && _receiver->throttleIsDown()) {
+                    cutMotors();
                 }
 
                 // Set LED based on arming status
-                _board->showArmedStatus(_state.armed);
+                _board->showArmedStatus(state.armed);
 
             } // checkReceiver
 
@@ -259,17 +354,31 @@ namespace hf {
                 }
             }
 
-            void updateFull(void)
+            void checkSensors(void)
             {
-                // Check mandatory sensors
-                checkGyrometer();
+                // Check mandatory sensors, running PID controllers on a fresh gyro sample in gyro-sync mode
+                bool gotGyro = checkGyrometer();
+                _loopTimer.lap(LoopTimer::STAGE_GYROMETER);
+                if (gotGyro && _gyroSync) {
+                    _pidTask.doTask();
+                    _loopTimer.lap(LoopTimer::STAGE_PID);
+                }
                 checkQuaternion();
+                _loopTimer.lap(LoopTimer::STAGE_QUATERNION);
 
                 // Check optional sensors
                 checkOptionalSensors();
+            }
+
+            void updateFull(void)
+            {
+                checkSensors();
+            }
 
-                // Update serial comms task
-                _serialTask.update();
+            // The PID task runs on its own schedule unless the gyrometer or the other core is driving it
+            void schedulePidTask(void)
+            {
+                _scheduler.enable(&_pidTask, !_gyroSync && !_dualCore);
             }
 
         public:
@@ -284,14 +393,15 @@ namespace hf {
                 _mixer = mixer;
 
                 // Initialize serial timer task
-                _serialTask.init(board, &_state, mixer, receiver);
+                _serialTask.init(board, &_state, mixer, receiver, &_loopTimer, &_scheduler);
+                _scheduler.add(&_serialTask, PRIORITY_SERIAL, LoopTimer::STAGE_SERIAL);
 
                 // Support safety override by simulator
                 _state.armed = armed;
 
-                // Support for mandatory sensors
-                add_sensor(&_quaternion, imu);
-                add_sensor(&_gyrometer, imu);
+                // Support for mandatory sensors, which we check separately from the optional ones
+                _quaternion.imu = imu;
+                _gyrometer.imu = imu;
 
                 // Start the IMU
                 imu->begin();
@@ -321,23 +431,176 @@ namespace hf {
                 _updater->init(this);
             }
 
-            void addSensor(Sensor * sensor) 
+            // Returns false, and the vehicle will not arm, if there are already MAX_SENSORS sensors
+            bool addSensor(Sensor * sensor) 
+            {
+                return add_sensor(sensor);
+            }
+
+            // Returns false, and the vehicle will not arm, if there are already PidTask::MAX_PID_CONTROLLERS
+            bool addPidController(PidController * pidController, uint8_t auxState=0) 
+            {
+                if (!_pidTask.addPidController(pidController, auxState)) {
+                    _overCapacity = true;
+                    return false;
+                }
+
+                return true;
+            }
+
+            /**
+             * Runs the PID controllers and mixer on each new gyrometer sample, giving a fixed
+             * gyro-to-motor latency.  Because PID controllers absorb dt into their constants,
+             * gains tuned for the PID timer rate may need re-tuning at the gyro rate.
+             * Call after init().
+             */
+            void setGyroSync(bool gyroSync)
             {
-                add_sensor(sensor);
+                // Gyro sync makes no sense without a gyrometer (receiver-proxy build)
+                _gyroSync = gyroSync && (_imu != NULL);
+
+                schedulePidTask();
             }
 
-            void addPidController(PidController * pidController, uint8_t auxState=0) 
+            /**
+             * Filters each raw gyrometer sample before it updates the vehicle state; see GyroPipeline.
+             * With a decimating filter, the state (and, in gyro-sync mode, the PID controllers) updates
+             * only on the samples the filter passes.  Call after init().
+             */
+            void setGyroFilter(GyroFilter * filter)
             {
-                _pidTask.addPidController(pidController, auxState);
+                _gyrometer._filter = filter;
+            }
+
+            /**
+             * Runs a task of your own from the scheduler, along with the PID and serial tasks.
+             * Higher priorities run first when several tasks are due; PID is 200, serial 100.
+             * Call after init().  Returns false, and the vehicle will not arm, if there are
+             * already Scheduler::MAX_TASKS tasks.
+             */
+            bool addTask(TimerTask * task, uint8_t priority)
+            {
+                if (!_scheduler.add(task, priority)) {
+                    _overCapacity = true;
+                    return false;
+                }
+
+                task->init(_board);
+
+                return true;
+            }
+
+            /**
+             * Splits update() into updateFast() (PID controllers, mixer, sensors) and
+             * updateComms() (receiver, MSP, debug output), to be run concurrently on
+             * two cores; see DualCore.  Not supported with a receiver proxy.
+             * Call after init() and after adding sensors and PID controllers.
+             */
+            void setDualCore(bool dualCore)
+            {
+                // Receiver-proxy build: no IMU, mixer, or serial task to split
+                if (!_imu) {
+                    return;
+                }
+
+                _dualCore = dualCore;
+
+                _pidTask._snapshot = _dualCore ? &_commsOutput.command : NULL;
+
+                _serialTask._state = _dualCore ? &_commsState : &_state;
+                _serialTask._runDisarmedMotors = !_dualCore;
+                _serialTask._loopTimingSnapshot = _dualCore ? &_loopTimingSnapshot : NULL;
+                _serialTask._motorsDisarmed = _dualCore ? _commsMotorsDisarmed : _mixer->motorsDisarmed;
+
+                // The comms core runs the scheduler, but the loop timer belongs to the fast core
+                _scheduler._loopTimer = _dualCore ? NULL : &_loopTimer;
+                schedulePidTask();
+
+                // Start both cores from the same arming state (e.g., armed by a simulator)
+                _commsState = _state;
+                _commsOutput.armed = _state.armed;
+                _commsOutput.failsafe = _state.failsafe;
+                _commsOutput.loopTimingStage = _serialTask._loopTimingStage;
+                memcpy(_commsMotorsDisarmed, _mixer->motorsDisarmed, sizeof(_commsMotorsDisarmed));
+                memcpy(_commsOutput.motorsDisarmed, _commsMotorsDisarmed, sizeof(_commsMotorsDisarmed));
+                _commsOutputSnapshot.write(_commsOutput);
+
+                LoopTimer::stageSnapshot_t timing = {};
+                _loopTimer.snapshot(_commsOutput.loopTimingStage, timing);
+                _loopTimingSnapshot.write(timing);
+            }
+
+            // Dual-core mode: gyrometer, PID controllers, mixer, and sensors
+            void updateFast(void)
+            {
+                _loopTimer.start();
+
+                // Pick up the latest receiver command and arming state from the comms core.  This loop never
+                // waits: if the comms core is mid-write, we keep the last complete command until next time.
+                if (_commsOutputSnapshot.tryRead(_commsOutput)) {
+                    _state.armed = _commsOutput.armed;
+                    _state.failsafe = _commsOutput.failsafe;
+                }
+
+                // Update PID controllers task, unless gyrometer is driving it
+                if (!_gyroSync) {
+                    _loopTimer.lap(_pidTask.update() ? LoopTimer::STAGE_PID : LoopTimer::STAGE_NONE);
+                }
+
+                checkSensors();
+
+                // The comms core never touches the motors, so we do its motor cuts and GCS motor tests here
+                if (!_state.armed) {
+                    memcpy(_mixer->motorsDisarmed, _commsOutput.motorsDisarmed, sizeof(_commsOutput.motorsDisarmed));
+                    _mixer->runDisarmed();
+                }
+                else if (_state.failsafe || _commsOutput.command.throttleIsDown) {
+                    _mixer->cut();
+                }
+
+                _stateSnapshot.write(_state);
+
+                // Statistics for the loop stage the comms core wants to report
+                LoopTimer::stageSnapshot_t timing = {};
+                _loopTimer.snapshot(_commsOutput.loopTimingStage, timing);
+                _loopTimingSnapshot.write(timing);
+            }
+
+            // Dual-core mode: receiver, MSP, and debug output
+            void updateComms(void)
+            {
+                // Refresh our view of the vehicle, keeping the arming state, which belongs to this core
+                commsOutput_t output = {};
+                output.armed = _commsState.armed;
+                output.failsafe = _commsState.failsafe;
+                _stateSnapshot.read(_commsState);
+                _commsState.armed = output.armed;
+                _commsState.failsafe = output.failsafe;
+
+                checkReceiver(_commsState);
+
+                // Serial task and any added tasks; the PID task runs on the fast core
+                _scheduler.run();
+
+                // Send the receiver command and arming state to the fast core
+                _pidTask.readReceiver(output.command);
+                output.armed = _commsState.armed;
+                output.failsafe = _commsState.failsafe;
+                output.loopTimingStage = _serialTask._loopTimingStage;
+                memcpy(output.motorsDisarmed, _commsMotorsDisarmed, sizeof(output.motorsDisarmed));
+                _commsOutputSnapshot.write(output);
             }
 
             void update(void)
             {
+                _loopTimer.start();
+
                 // Grab control signal if available
-                checkReceiver();
+                checkReceiver(_state);
+                _loopTimer.lap(LoopTimer::STAGE_RECEIVER);
 
-                // Update PID controllers task
-                _pidTask.update();
+                // Run PID controllers task (unless gyrometer is driving it), serial task, and any others
+                _scheduler.run();
 
                 // Run full or lite update function
                 _updater->update();
@@ -0,0 +1,247 @@
+/*
+   IIR filters (PT1, PT2, biquad lowpass and notch) for gyro and D-term filtering
+
+   Each filter runs N channels at once (by default 3, for roll, pitch, and yaw).
+   State and coefficients are held as one array per quantity, indexed by
+   channel, so update() is a fixed-length loop over arrays that compilers can
+   unroll or vectorize.  Coefficients are per channel too, so one channel can
+   be retuned without disturbing the others.
+
+   Biquad coefficients follow Robert Bristow-Johnson's Audio EQ Cookbook; the
+   filter runs in transposed direct form II.
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+namespace hf {
+
+    // First-order lowpass: y += k (x - y)
+    template <uint8_t N=3>
+    class Pt1Filter {
+
+        static_assert(N > 0, "Pt1Filter needs at least one channel");
+
+        private:
+
+            float _k[N] = {0};
+            float _y[N] = {0};
+
+        public:
+
+            // Gain for a given cutoff, from the RC time constant
+            static float gain(float cutoffHz, float sampleHz)
+            {
+                float rc = 1 / (2 * (float)M_PI * cutoffHz);
+                float dt = 1 / sampleHz;
+
+                return dt / (rc + dt);
+            }
+
+            void init(float cutoffHz, float sampleHz)
+            {
+                for (uint8_t k=0; k<N; ++k) {
+                    setCutoff(k, cutoffHz, sampleHz);
+                    _y[k] = 0;
+                }
+            }
+
+            // Keeps the channel's output, so the cutoff can change in flight
+            void setCutoff(uint8_t channel, float cutoffHz, float sampleHz)
+            {
+                _k[channel] = gain(cutoffHz, sampleHz);
+            }
+
+            // Filters all channels in place
+            void update(float values[N])
+            {
+                for (uint8_t k=0; k<N; ++k) {
+                    _y[k] += _k[k] * (values[k] - _y[k]);
+                    values[k] = _y[k];
+                }
+            }
+
+    }; // class Pt1Filter
+
+    // Two PT1 stages in series, each with its cutoff raised so that the pair is 3 dB down at the cutoff.
+    // Rolls off twice as fast as a PT1, with less delay than a biquad and no overshoot.
+    template <uint8_t N=3>
+    class Pt2Filter {
+
+        static_assert(N > 0, "Pt2Filter needs at least one channel");
+
+        private:
+
+            // 1 / sqrt(2^(1/2) - 1)
+            static constexpr float CUTOFF_CORRECTION = 1.553773974f;
+
+            float _k[N] = {0};
+            float _y1[N] = {0};
+            float _y2[N] = {0};
+
+        public:
+
+            void init(float cutoffHz, float sampleHz)
+            {
+                for (uint8_t k=0; k<N; ++k) {
+                    setCutoff(k, cutoffHz, sampleHz);
+                    _y1[k] = 0;
+                    _y2[k] = 0;
+                }
+            }
+
+            void setCutoff(uint8_t channel, float cutoffHz, float sampleHz)
+            {
+                _k[channel] = Pt1Filter<N>::gain(cutoffHz * CUTOFF_CORRECTION, sampleHz);
+            }
+
+            void update(float values[N])
+            {
+                for (uint8_t k=0; k<N; ++k) {
+                    _y1[k] += _k[k] * (values[k] - _y1[k]);
+                    _y2[k] += _k[k] * (_y1[k] - _y2[k]);
+                    values[k] = _y2[k];
+                }
+            }
+
+    }; // class Pt2Filter
+
+    template <uint8_t N=3>
+    class BiquadFilter {
+
+        static_assert(N > 0, "BiquadFilter needs at least one channel");
+
+        private:
+
+            // Coefficients, normalized so that a0 = 1
+            float _b0[N] = {0};
+            float _b1[N] = {0};
+            float _b2[N] = {0};
+            float _a1[N] = {0};
+            float _a2[N] = {0};
+
+            // State
+            float _z1[N] = {0};
+            float _z2[N] = {0};
+
+            void set(uint8_t channel, float b0, float b1, float b2, float a0, float a1, float a2)
+            {
+                _b0[channel] = b0 / a0;
+                _b1[channel] = b1 / a0;
+                _b2[channel] = b2 / a0;
+                _a1[channel] = a1 / a0;
+                _a2[channel] = a2 / a0;
+            }
+
+            // Frequencies at or above Nyquist can't be filtered, so we pass the input through
+            bool passThrough(uint8_t channel, float hz, float sampleHz)
+            {
+                if (hz > 0 && hz < sampleHz / 2) {
+                    return false;
+                }
+
+                set(channel, 1, 0, 0, 1, 0, 0);
+
+                return true;
+            }
+
+        public:
+
+            static constexpr float BUTTERWORTH_Q = 0.70710678f;
+
+            // Q for a notch at centerHz whose -3 dB band starts at lowerHz
+            static float notchQ(float centerHz, float lowerHz)
+            {
+                return centerHz * lowerHz / (centerHz * centerHz - lowerHz * lowerHz);
+            }
+
+            void initLowpass(float cutoffHz, float sampleHz, float q=BUTTERWORTH_Q)
+            {
+                for (uint8_t k=0; k<N; ++k) {
+                    setLowpass(k, cutoffHz, sampleHz, q);
+                }
+                reset();
+            }
+
+            void initNotch(float centerHz, float sampleHz, float q)
+            {
+                for (uint8_t k=0; k<N; ++k) {
+                    setNotch(k, centerHz, sampleHz, q);
+                }
+                reset();
+            }
+
+            void setLowpass(uint8_t channel, float cutoffHz, float sampleHz, float q=BUTTERWORTH_Q)
+            {
+                if (passThrough(channel, cutoffHz, sampleHz)) {
+                    return;
+                }
+
+                float omega = 2 * (float)M_PI * cutoffHz / sampleHz;
+                float sn = sinf(omega);
+                float cs = cosf(omega);
+                float alpha = sn / (2 * q);
+
+                set(channel, (1 - cs) / 2, 1 - cs, (1 - cs) / 2, 1 + alpha, -2 * cs, 1 - alpha);
+            }
+
+            // Keeps the channel's state, so a notch can follow a moving frequency in flight
+            void setNotch(uint8_t channel, float centerHz, float sampleHz, float q)
+            {
+                if (passThrough(channel, centerHz, sampleHz)) {
+                    return;
+                }
+
+                float omega = 2 * (float)M_PI * centerHz / sampleHz;
+                float sn = sinf(omega);
+                float cs = cosf(omega);
+                float alpha = sn / (2 * q);
+
+                set(channel, 1, -2 * cs, 1, 1 + alpha, -2 * cs, 1 - alpha);
+            }
+
+            void reset(void)
+            {
+                for (uint8_t k=0; k<N; ++k) {
+                    reset(k);
+                }
+            }
+
+            void reset(uint8_t channel)
+            {
+                _z1[channel] = 0;
+                _z2[channel] = 0;
+            }
+
+            void update(float values[N])
+            {
+                for (uint8_t k=0; k<N; ++k) {
+                    float x = values[k];
+                    float y = _b0[k] * x + _z1[k];
+                    _z1[k] = _b1[k] * x - _a1[k] * y + _z2[k];
+                    _z2[k] = _b2[k] * x - _a2[k] * y;
+                    values[k] = y;
+                }
+            }
+
+    }; // class BiquadFilter
+
+} // namespace hf
@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <stdint.h>
+
 namespace hf {
 
     class IMU {
@@ -42,11 +44,13 @@ namespace hf {
         friend class Hackflight;
         friend class Quaternion;
         friend class Gyrometer;
+        friend class RecordingIMU;
+        template <typename, typename, typename, typename, typename, typename...> friend class StaticHackflight;
 
         protected:
 
             // Core functionality
-            virtual bool getQuaternion(float & qw, float & qx, float & qy, float & qz, float time) = 0;
+            virtual bool getQuaternion(float & qw, float & qx, float & qy, float & qz, uint32_t usec) = 0;
             virtual bool getGyrometer(float & gx, float & gy, float & gz) = 0;
 
             // Adjustment for non-standard mounting
@@ -27,23 +27,22 @@
 
 namespace hf {
 
+    // The estimator is any class in filters.hpp with update(ax, ay, az, gx, gy, gz, deltat) and a default
+    // constructor: MadgwickQuaternionFilter6DOF, MahonyQuaternionFilter6DOF, or ComplementaryQuaternionFilter.  The
+    // quaternion is updated once every DIVISOR gyro readings; the Madgwick filter has always run at a fifth of the
+    // gyro rate, but the other two are cheap enough to run at the full rate (DIVISOR = 1).
+    template <typename Estimator=MadgwickQuaternionFilter6DOF, uint8_t DIVISOR=5>
     class SoftwareQuaternionIMU : public IMU {
 
-        private:
-
-            // Global constants for 6 DoF quaternion filter
-            const float GYRO_MEAS_ERROR_DEG = 20.f;
-            const float GYRO_MEAS_DRIFT_DEG =  0.f;
+        static_assert(DIVISOR > 0, "SoftwareQuaternionIMU divisor must be at least one");
 
-            // Update quaternion after this number of gyro updates
-            const uint8_t QUATERNION_DIVISOR = 5;
+        private:
 
             // Supports computing quaternion after a certain number of IMU readings
             uint8_t _quatCycleCount = 0;
 
-            // Params passed to Madgwick quaternion constructor
-            const float _beta = sqrtf(3.0f / 4.0f) * Filter::deg2rad(GYRO_MEAS_ERROR_DEG);
-            const float _zeta = sqrtf(3.0f / 4.0f) * Filter::deg2rad(GYRO_MEAS_DRIFT_DEG);  
+            // Time of last filter update, for integration time
+            uint32_t _quatUsec = 0;
 
             float _ax = 0;
             float _ay = 0;
@@ -56,7 +55,7 @@ namespace hf {
 
             // Quaternion support: even though MPU9250 has a magnetometer, we keep it simple for now by 
             // using a 6DOF fiter (accel, gyro)
-            MadgwickQuaternionFilter6DOF _quaternionFilter = MadgwickQuaternionFilter6DOF(_beta, _zeta);
+            Estimator _quaternionFilter;
 
             virtual bool imuReady(void) = 0;
 
@@ -71,23 +70,27 @@ namespace hf {
 
                     imuReadAccelGyro(_ax, _ay, _az, _gx, _gy, _gz);
 
+                    // The rate PID runs on these, and the estimator on the copies we keep
+                    gx = _gx;
+                    gy = _gy;
+                    gz = _gz;
+
                     return true;
                 }
 
                 return false;
             }
 
-            bool getQuaternion(float & qw, float & qx, float & qy, float & qz, float time) override
+            bool getQuaternion(float & qw, float & qx, float & qy, float & qz, uint32_t usec) override
             {
                 // Update quaternion after some number of IMU readings
-                _quatCycleCount = (_quatCycleCount + 1) % QUATERNION_DIVISOR;
+                _quatCycleCount = (_quatCycleCount + 1) % DIVISOR;
 
                 if (_quatCycleCount == 0) {
 
                     // Set integration time by time elapsed since last filter update
-                    static float _time;
-                    float deltat = time - _time;
-                    _time = time;
+                    float deltat = (usec - _quatUsec) / 1.e6f;
+                    _quatUsec = usec;
 
                     // Run the quaternion on the IMU values acquired in imuReadAccelGyro()                   
                     _quaternionFilter.update(_ax, _ay, _az, _gx, _gy, _gz, deltat); 
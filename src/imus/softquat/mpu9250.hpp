@@ -41,7 +41,8 @@ namespace hf {
     // Instantiate MPU9250 class in master mode
     static MPU9250_Master_I2C _mpu9250_imu(ASCALE, GSCALE, MSCALE, MMODE, SAMPLE_RATE_DIVISOR);
 
-    class MPU9250SoftwareQuaternionIMU : public SoftwareQuaternionIMU {
+    template <typename Estimator=MadgwickQuaternionFilter6DOF, uint8_t DIVISOR=5>
+    class MPU9250SoftwareQuaternionIMU : public SoftwareQuaternionIMU<Estimator, DIVISOR> {
 
         private:
 
@@ -28,7 +28,8 @@
 
 namespace hf {
 
-    class NxpSoftwareQuaternionIMU : public SoftwareQuaternionIMU {
+    template <typename Estimator=MadgwickQuaternionFilter6DOF, uint8_t DIVISOR=5>
+    class NxpSoftwareQuaternionIMU : public SoftwareQuaternionIMU<Estimator, DIVISOR> {
 
         private:
 
@@ -74,9 +74,9 @@ namespace hf {
                 return false;
             }
 
-            virtual bool getQuaternion(float & qw, float & qx, float & qy, float & qz, float time) override
+            virtual bool getQuaternion(float & qw, float & qx, float & qy, float & qz, uint32_t usec) override
             {
-                (void)time;
+                (void)usec;
 
                 if (_sentral.gotQuaternion()) {
 
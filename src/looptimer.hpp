@@ -0,0 +1,162 @@
+/*
+   Per-stage timing statistics for the Hackflight update loop
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "board.hpp"
+
+namespace hf {
+
+    class StageTimer {
+
+        friend class LoopTimer;
+        friend class SerialTask;
+
+        public:
+
+            // Bucket k counts durations in [2^k, 2^(k+1)) usec, except that bucket 0 also counts 0 usec
+            // and the last bucket counts everything longer
+            static const uint8_t BUCKETS = 12;
+
+        private:
+
+            uint32_t _count = 0;
+            uint32_t _min = 0;
+            uint32_t _max = 0;
+            uint64_t _sum = 0;
+
+            uint32_t _buckets[BUCKETS] = {0};
+
+            static uint8_t bucket(uint32_t usec)
+            {
+                // floor(log2(usec)), with 0 and 1 both going to bucket 0
+                uint8_t k = 31 - __builtin_clz(usec | 1);
+
+                return k < BUCKETS ? k : BUCKETS-1;
+            }
+
+            void record(uint32_t usec)
+            {
+                if (_count == 0 || usec < _min) {
+                    _min = usec;
+                }
+
+                if (usec > _max) {
+                    _max = usec;
+                }
+
+                _sum += usec;
+                _count++;
+
+                _buckets[bucket(usec)]++;
+            }
+
+            uint32_t mean(void)
+            {
+                return _count ? (uint32_t)(_sum / _count) : 0;
+            }
+
+    }; // class StageTimer
+
+    class LoopTimer {
+
+        friend class Hackflight;
+        friend class SerialTask;
+        friend class Scheduler;
+
+        public:
+
+            // Stages of Hackflight::update(); optional sensors follow, in the order they were added
+            enum {
+                STAGE_RECEIVER,
+                STAGE_PID,
+                STAGE_GYROMETER,
+                STAGE_QUATERNION,
+                STAGE_SERIAL,
+                STAGE_SENSORS,
+
+                // Passed to lap() when a stage did no work and shouldn't be recorded
+                STAGE_NONE = 0xFF
+            };
+
+            static const uint8_t MAX_STAGES = 16;
+
+            // One stage's statistics, copied out for the comms core in dual-core mode
+            typedef struct {
+
+                uint8_t stage;
+                uint8_t stageCount;
+                StageTimer timer;
+
+            } stageSnapshot_t;
+
+        private:
+
+            Board * _board = NULL;
+
+            StageTimer _stages[MAX_STAGES];
+
+            uint8_t _stageCount = STAGE_SENSORS;
+
+            // Start time of the stage now running
+            uint32_t _usec = 0;
+
+            void init(Board * board)
+            {
+                _board = board;
+            }
+
+            void addSensorStage(void)
+            {
+                if (_stageCount < MAX_STAGES) {
+                    _stageCount++;
+                }
+            }
+
+            // Starts timing a new stage
+            void start(void)
+            {
+                _usec = _board->getMicroseconds();
+            }
+
+            void snapshot(uint8_t stage, stageSnapshot_t & snapshot)
+            {
+                snapshot.stage = stage;
+                snapshot.stageCount = _stageCount;
+                snapshot.timer = stage < _stageCount ? _stages[stage] : StageTimer();
+            }
+
+            // Ends the current stage and starts the next one, using a single clock read for both
+            void lap(uint8_t stage)
+            {
+                uint32_t usec = _board->getMicroseconds();
+
+                if (stage < _stageCount) {
+                    _stages[stage].record(usec - _usec);
+                }
+
+                _usec = usec;
+            }
+
+    }; // class LoopTimer
+
+} // namespace hf
@@ -32,7 +32,7 @@ namespace hf {
 
             static const uint8_t MAX_COUNT = 20; // arbitrary
 
-            uint8_t _pins[MAX_COUNT];
+            uint8_t _pins[MAX_COUNT] = {0};
             uint8_t _count = 0;
 
             Motor(const uint8_t count) 
@@ -311,6 +311,74 @@ namespace hf {
                         serialize8(_checksum);
                         } break;
 
+                    case 123:
+                    {
+                        int32_t stage = 0;
+                        int32_t stageCount = 0;
+                        int32_t count = 0;
+                        int32_t minUsec = 0;
+                        int32_t maxUsec = 0;
+                        int32_t meanUsec = 0;
+                        int32_t b0 = 0;
+                        int32_t b1 = 0;
+                        int32_t b2 = 0;
+                        int32_t b3 = 0;
+                        int32_t b4 = 0;
+                        int32_t b5 = 0;
+                        int32_t b6 = 0;
+                        int32_t b7 = 0;
+                        int32_t b8 = 0;
+                        int32_t b9 = 0;
+                        int32_t b10 = 0;
+                        int32_t b11 = 0;
+                        handle_LOOP_TIMING_Request(stage, stageCount, count, minUsec, maxUsec, meanUsec, b0, b1, b2, b3, b4, b5, b6, b7, b8, b9, b10, b11);
+                        prepareToSendInts(18);
+                        sendInt(stage);
+                        sendInt(stageCount);
+                        sendInt(count);
+                        sendInt(minUsec);
+                        sendInt(maxUsec);
+                        sendInt(meanUsec);
+                        sendInt(b0);
+                        sendInt(b1);
+                        sendInt(b2);
+                        sendInt(b3);
+                        sendInt(b4);
+                        sendInt(b5);
+                        sendInt(b6);
+                        sendInt(b7);
+                        sendInt(b8);
+                        sendInt(b9);
+                        sendInt(b10);
+                        sendInt(b11);
+                        serialize8(_checksum);
+                        } break;
+
+                    case 124:
+                    {
+                        int32_t index = 0;
+                        int32_t taskCount = 0;
+                        int32_t priority = 0;
+                        int32_t count = 0;
+                        int32_t overruns = 0;
+                        int32_t skipped = 0;
+                        int32_t rateMilliHz = 0;
+                        int32_t meanJitterUsec = 0;
+                        int32_t maxJitterUsec = 0;
+                        handle_TASK_TIMING_Request(index, taskCount, priority, count, overruns, skipped, rateMilliHz, meanJitterUsec, maxJitterUsec);
+                        prepareToSendInts(9);
+                        sendInt(index);
+                        sendInt(taskCount);
+                        sendInt(priority);
+                        sendInt(count);
+                        sendInt(overruns);
+                        sendInt(skipped);
+                        sendInt(rateMilliHz);
+                        sendInt(meanJitterUsec);
+                        sendInt(maxJitterUsec);
+                        serialize8(_checksum);
+                        } break;
+
                     case 213:
                     {
                         float vx = 0;
@@ -376,6 +444,22 @@ namespace hf {
                         handle_SET_ARMED(flag);
                         } break;
 
+                    case 218:
+                    {
+                        uint8_t stage = 0;
+                        memcpy(&stage,  &_inBuf[0], sizeof(uint8_t));
+
+                        handle_SET_LOOP_TIMING_STAGE(stage);
+                        } break;
+
+                    case 219:
+                    {
+                        uint8_t index = 0;
+                        memcpy(&index,  &_inBuf[0], sizeof(uint8_t));
+
+                        handle_SET_TASK_TIMING_INDEX(index);
+                        } break;
+
                 }
             }
 
@@ -407,6 +491,41 @@ namespace hf {
                 (void)yaw;
             }
 
+            virtual void handle_LOOP_TIMING_Request(int32_t & stage, int32_t & stageCount, int32_t & count, int32_t & minUsec, int32_t & maxUsec, int32_t & meanUsec, int32_t & b0, int32_t & b1, int32_t & b2, int32_t & b3, int32_t & b4, int32_t & b5, int32_t & b6, int32_t & b7, int32_t & b8, int32_t & b9, int32_t & b10, int32_t & b11)
+            {
+                (void)stage;
+                (void)stageCount;
+                (void)count;
+                (void)minUsec;
+                (void)maxUsec;
+                (void)meanUsec;
+                (void)b0;
+                (void)b1;
+                (void)b2;
+                (void)b3;
+                (void)b4;
+                (void)b5;
+                (void)b6;
+                (void)b7;
+                (void)b8;
+                (void)b9;
+                (void)b10;
+                (void)b11;
+            }
+
+            virtual void handle_TASK_TIMING_Request(int32_t & index, int32_t & taskCount, int32_t & priority, int32_t & count, int32_t & overruns, int32_t & skipped, int32_t & rateMilliHz, int32_t & meanJitterUsec, int32_t & maxJitterUsec)
+            {
+                (void)index;
+                (void)taskCount;
+                (void)priority;
+                (void)count;
+                (void)overruns;
+                (void)skipped;
+                (void)rateMilliHz;
+                (void)meanJitterUsec;
+                (void)maxJitterUsec;
+            }
+
             virtual void handle_SET_VELOCITY_SETPOINTS(float  vx, float  vy, float  vz, float  yaw_rate)
             {
                 (void)vx;
@@ -438,6 +557,16 @@ namespace hf {
                 (void)flag;
             }
 
+            virtual void handle_SET_LOOP_TIMING_STAGE(uint8_t  stage)
+            {
+                (void)stage;
+            }
+
+            virtual void handle_SET_TASK_TIMING_INDEX(uint8_t  index)
+            {
+                (void)index;
+            }
+
         public:
 
             static uint8_t serialize_STATE_Request(uint8_t bytes[])
@@ -534,6 +663,85 @@ namespace hf {
                 return 18;
             }
 
+            static uint8_t serialize_LOOP_TIMING_Request(uint8_t bytes[])
+            {
+                bytes[0] = 36;
+                bytes[1] = 77;
+                bytes[2] = 60;
+                bytes[3] = 0;
+                bytes[4] = 123;
+                bytes[5] = 123;
+
+                return 6;
+            }
+
+            static uint8_t serialize_LOOP_TIMING(uint8_t bytes[], int32_t  stage, int32_t  stageCount, int32_t  count, int32_t  minUsec, int32_t  maxUsec, int32_t  meanUsec, int32_t  b0, int32_t  b1, int32_t  b2, int32_t  b3, int32_t  b4, int32_t  b5, int32_t  b6, int32_t  b7, int32_t  b8, int32_t  b9, int32_t  b10, int32_t  b11)
+            {
+                bytes[0] = 36;
+                bytes[1] = 77;
+                bytes[2] = 62;
+                bytes[3] = 72;
+                bytes[4] = 123;
+
+                memcpy(&bytes[5], &stage, sizeof(int32_t));
+                memcpy(&bytes[9], &stageCount, sizeof(int32_t));
+                memcpy(&bytes[13], &count, sizeof(int32_t));
+                memcpy(&bytes[17], &minUsec, sizeof(int32_t));
+                memcpy(&bytes[21], &maxUsec, sizeof(int32_t));
+                memcpy(&bytes[25], &meanUsec, sizeof(int32_t));
+                memcpy(&bytes[29], &b0, sizeof(int32_t));
+                memcpy(&bytes[33], &b1, sizeof(int32_t));
+                memcpy(&bytes[37], &b2, sizeof(int32_t));
+                memcpy(&bytes[41], &b3, sizeof(int32_t));
+                memcpy(&bytes[45], &b4, sizeof(int32_t));
+                memcpy(&bytes[49], &b5, sizeof(int32_t));
+                memcpy(&bytes[53], &b6, sizeof(int32_t));
+                memcpy(&bytes[57], &b7, sizeof(int32_t));
+                memcpy(&bytes[61], &b8, sizeof(int32_t));
+                memcpy(&bytes[65], &b9, sizeof(int32_t));
+                memcpy(&bytes[69], &b10, sizeof(int32_t));
+                memcpy(&bytes[73], &b11, sizeof(int32_t));
+
+                bytes[77] = CRC8(&bytes[3], 74);
+
+                return 78;
+            }
+
+            static uint8_t serialize_TASK_TIMING_Request(uint8_t bytes[])
+            {
+                bytes[0] = 36;
+                bytes[1] = 77;
+                bytes[2] = 60;
+                bytes[3] = 0;
+                bytes[4] = 124;
+                bytes[5] = 124;
+
+                return 6;
+            }
+
+            static uint8_t serialize_TASK_TIMING(uint8_t bytes[], int32_t  index, int32_t  taskCount, int32_t  priority, int32_t  count, int32_t  overruns, int32_t  skipped, int32_t  rateMilliHz, int32_t  meanJitterUsec, int32_t  maxJitterUsec)
+            {
+                bytes[0] = 36;
+                bytes[1] = 77;
+                bytes[2] = 62;
+                bytes[3] = 36;
+                bytes[4] = 124;
+
+                memcpy(&bytes[5], &index, sizeof(int32_t));
+                memcpy(&bytes[9], &taskCount, sizeof(int32_t));
+                memcpy(&bytes[13], &priority, sizeof(int32_t));
+                memcpy(&bytes[17], &count, sizeof(int32_t));
+                memcpy(&bytes[21], &overruns, sizeof(int32_t));
+                memcpy(&bytes[25], &skipped, sizeof(int32_t));
+                memcpy(&bytes[29], &rateMilliHz, sizeof(int32_t));
+                memcpy(&bytes[33], &meanJitterUsec, sizeof(int32_t));
+                memcpy(&bytes[37], &maxJitterUsec, sizeof(int32_t));
+
+                bytes[41] = CRC8(&bytes[3], 38);
+
+                return 42;
+            }
+
             static uint8_t serialize_SET_VELOCITY_SETPOINTS(uint8_t bytes[], float  vx, float  vy, float  vz, float  yaw_rate)
             {
                 bytes[0] = 36;
@@ -605,6 +813,36 @@ namespace hf {
                 return 7;
             }
 
+            static uint8_t serialize_SET_LOOP_TIMING_STAGE(uint8_t bytes[], uint8_t  stage)
+            {
+                bytes[0] = 36;
+                bytes[1] = 77;
+                bytes[2] = 62;
+                bytes[3] = 1;
+                bytes[4] = 218;
+
+                memcpy(&bytes[5], &stage, sizeof(uint8_t));
+
+                bytes[6] = CRC8(&bytes[3], 3);
+
+                return 7;
+            }
+
+            static uint8_t serialize_SET_TASK_TIMING_INDEX(uint8_t bytes[], uint8_t  index)
+            {
+                bytes[0] = 36;
+                bytes[1] = 77;
+                bytes[2] = 62;
+                bytes[3] = 1;
+                bytes[4] = 219;
+
+                memcpy(&bytes[5], &index, sizeof(uint8_t));
+
+                bytes[6] = CRC8(&bytes[3], 3);
+
+                return 7;
+            }
+
     }; // class MspParser
 
 } // namespace hf
@@ -28,11 +28,81 @@ namespace hf {
     class PidController {
 
         friend class PidTask;
+        template <typename...> friend class StaticPidControllers;
+
+        private:
+
+            // Support for running slower than the PID task, holding our last demands in between
+            uint32_t _period = 0; // usec
+            uint32_t _usec = 0;
+            bool _running = false;
+            demands_t _heldDemands = {};
+
+            // Demands this controller sets, which it holds between updates
+            uint8_t _demands = 0;
+
+            static void holdDemand(float & demand, float held, uint8_t modified, uint8_t mask)
+            {
+                if (modified & mask) {
+                    demand = held;
+                }
+            }
+
+            void run(state_t * state, demands_t & demands, uint32_t usec)
+            {
+                // Not due yet: re-apply the demands from our last update
+                if (_running && (uint32_t)(usec - _usec) < _period) {
+                    holdDemand(demands.throttle, _heldDemands.throttle, _demands, DEMAND_THROTTLE);
+                    holdDemand(demands.roll,     _heldDemands.roll,     _demands, DEMAND_ROLL);
+                    holdDemand(demands.pitch,    _heldDemands.pitch,    _demands, DEMAND_PITCH);
+                    holdDemand(demands.yaw,      _heldDemands.yaw,      _demands, DEMAND_YAW);
+                    return;
+                }
+
+                modifyDemands(state, demands);
+
+                _heldDemands = demands;
+
+                // Keep to the schedule from our first update, so that the period doesn't stretch by however late
+                // each update happens to be; after falling more than a period behind, start afresh
+                _usec = _running ? _usec + _period : usec;
+                if ((uint32_t)(usec - _usec) >= _period) {
+                    _usec = usec;
+                }
+
+                _running = true;
+            }
+
+            // Called when our auxiliary switch state is inactive, so we update immediately on re-activation
+            void stop(void)
+            {
+                _running = false;
+            }
 
         protected:
 
             static constexpr float STICK_DEADBAND = 0.10;
 
+            // Demands a controller can set, as bits in THROTTLE, ROLL, PITCH, YAW order
+            enum {
+                DEMAND_THROTTLE = 0x01,
+                DEMAND_ROLL     = 0x02,
+                DEMAND_PITCH    = 0x04,
+                DEMAND_YAW      = 0x08,
+                DEMAND_ALL      = 0x0F
+            };
+
+            /**
+              * demands: the DEMAND_ bits for the demands modifyDemands() sets; these matter only with
+              *          a freq, so controllers written before they existed can keep the default
+              * freq: update rate in Hz; zero runs the controller on every PID task update
+              */
+            PidController(uint8_t demands=DEMAND_ALL, float freq=0)
+            {
+                _demands = demands;
+                _period = freq > 0 ? (uint32_t)(1.e6f / freq) : 0;
+            }
+
             virtual void modifyDemands(state_t * state, demands_t & demands) = 0;
 
             virtual bool shouldFlashLed(void) { return false; }
@@ -81,7 +81,11 @@ namespace hf {
 
         public:
 
-            AltitudeHoldPid(const float Kp_pos, const float Kp_vel, const float Ki_vel, const float Kd_vel) 
+            // Altitude changes slowly, so freq can be well under the PID task's rate (e.g. 50 Hz) to save time; but
+            // Ki_vel and Kd_vel absorb the update period, so gains tuned at one rate need retuning at another.
+            // The default, zero, runs on every PID task update.
+            AltitudeHoldPid(const float Kp_pos, const float Kp_vel, const float Ki_vel, const float Kd_vel, float freq=0) 
+                : PidController(DEMAND_THROTTLE, freq)
             {
                 _posPid.init(Kp_pos, 0, 0);
                 _velPid.init(Kp_vel, Ki_vel, Kd_vel);
@@ -30,6 +30,7 @@ namespace hf {
         public:
 
             FlowHoldPid(const float Kp, float Ki)
+                : PidController(DEMAND_ROLL | DEMAND_PITCH)
             {
                 rollPid.init(Kp, Ki, 0);
                 pitchPid.init(Kp, Ki, 0);
@@ -29,6 +29,11 @@ namespace hf {
 
         private:
 
+            // Outer loop can run slower than the rate controller it feeds.  This is above the PID task's
+            // 300 Hz, so it runs on every PID task update, and takes effect only in gyro-sync mode, where
+            // the rate controller runs at the gyro rate.  With no I or D terms, its gain is the same at any rate.
+            static constexpr float FREQ = 500;
+
             // Helper class
             class _AnglePid : public Pid {
 
@@ -60,6 +65,7 @@ namespace hf {
         public:
 
             LevelPid(float rollLevelP, float pitchLevelP)
+                : PidController(DEMAND_ROLL | DEMAND_PITCH, FREQ)
             {
                 _rollPid.init(rollLevelP);
                 _pitchPid.init(pitchLevelP);
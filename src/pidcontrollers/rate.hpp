@@ -76,6 +76,7 @@ namespace hf {
         public:
 
             RatePid(const float Kp, const float Ki, const float Kd, const float Kp_yaw, const float Ki_yaw) 
+                : PidController(DEMAND_ROLL | DEMAND_PITCH | DEMAND_YAW)
             {
                 _rollPid.init(Kp, Ki, Kd);
                 _pitchPid.init(Kp, Ki, Kd);
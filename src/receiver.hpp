@@ -24,6 +24,7 @@
 #include <math.h>
 
 #include "datatypes.hpp"
+#include "fastmath.hpp"
 
 namespace hf {
 
@@ -32,6 +33,8 @@ namespace hf {
         friend class Hackflight;
         friend class SerialTask;
         friend class PidTask;
+        friend class RecordingReceiver;
+        template <typename, typename, typename, typename, typename, typename...> friend class StaticHackflight;
 
         private: 
 
@@ -116,7 +119,7 @@ namespace hf {
             // Raw receiver values in [-1,+1]
             float rawvals[MAXCHAN] = {0};  
 
-            demands_t demands;
+            demands_t demands = {};
 
             float getRawval(uint8_t chan)
             {
@@ -171,8 +174,8 @@ namespace hf {
 
                 // Support headless mode
                 if (headless) {
-                    float c = cos(yawAngle);
-                    float s = sin(yawAngle);
+                    float s = 0, c = 0;
+                    FastMath::sincos(yawAngle, s, c);
                     float p = demands.pitch;
                     float r = demands.roll;
                     
@@ -19,6 +19,7 @@
 #pragma once
 
 #include "receiver.hpp"
+#include "ringbuffer.hpp"
 #include <DSMRX.h>
 
 namespace hf {
@@ -29,6 +30,27 @@ namespace hf {
 
             DSM2048 _rx;
 
+            // Raw bytes and their arrival times, passed from the serial interrupt to the main loop
+            typedef struct {
+
+                uint8_t  value;
+                uint32_t usec;
+
+            } serialByte_t;
+
+            // Room for four 16-byte DSMX frames
+            RingBuffer<serialByte_t, 64> _bytes;
+
+            // Parses the queued bytes in loop context, so the parser's state is never shared with the interrupt
+            void parseBytes(void)
+            {
+                serialByte_t b;
+
+                while (_bytes.pop(b)) {
+                    _rx.handleSerialEvent(b.value, b.usec);
+                }
+            }
+
         protected:
 
             void begin(void)
@@ -37,6 +59,8 @@ namespace hf {
 
             bool gotNewFrame(void)
             {
+                parseBytes();
+
                 return _rx.gotNewFrame();
             }
 
@@ -47,6 +71,8 @@ namespace hf {
 
             bool lostSignal(void)
             {
+                parseBytes();
+
                 return _rx.timedOut(micros());
             }
 
@@ -57,9 +83,12 @@ namespace hf {
             { 
             }
 
+            // Called from the serial interrupt: just timestamps and queues the byte
             void handleSerialEvent(uint8_t value, uint32_t usec)
             {
-                _rx.handleSerialEvent(value, usec);
+                serialByte_t b = {value, usec};
+
+                _bytes.push(b);
             }
 
     }; // class DSMX_Receiver
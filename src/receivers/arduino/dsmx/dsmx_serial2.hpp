@@ -55,6 +55,13 @@ namespace hf {
                 _dsmx_rx = this;
             }
 
+            // StaticHackflight holds its receiver by value, so the copy must take over the serial events
+            DSMX_Receiver_Serial2(const DSMX_Receiver_Serial2 & other)
+                :  DSMX_Receiver(other) 
+            { 
+                _dsmx_rx = this;
+            }
+
     }; // class DSMX_Receiver_Serial2
 
 } // namespace hf
@@ -0,0 +1,318 @@
+/*
+   Recording of IMU, receiver, and rangefinder readings with their timestamps,
+   for replay on a host build
+
+   Wrap the components you pass to Hackflight in RecordingIMU, RecordingReceiver,
+   and RecordingRangefinder, and give them a Recorder subclass that sends the
+   bytes somewhere (a file on the host, an SD card or spare serial port on a
+   board).
+
+   The stream starts with a four-byte header: 'H', 'F', 'R', VERSION.  Each
+   record that follows is a type byte, a 32-bit microsecond timestamp, and a
+   fixed number of 32-bit floats for that type (see payloadSize()), all in the
+   little-endian order of every platform we run on.
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string.h>
+
+#include "imu.hpp"
+#include "board.hpp"
+#include "receiver.hpp"
+#include "sensors/rangefinder.hpp"
+
+namespace hf {
+
+    class Recorder {
+
+        friend class RecordingIMU;
+        friend class RecordingReceiver;
+        friend class RecordingRangefinder;
+
+        public:
+
+            static const uint8_t VERSION = 1;
+
+            static const uint8_t HEADER_SIZE = 4;
+
+            typedef enum {
+
+                RECORD_GYROMETER = 1,
+                RECORD_QUATERNION,
+                RECORD_ACCELEROMETER,
+                RECORD_MAGNETOMETER,
+                RECORD_BAROMETER,
+                RECORD_RECEIVER_FRAME,  // raw channel values, Receiver::MAXCHAN of them
+                RECORD_LOST_SIGNAL,     // 1 or 0, recorded when it changes
+                RECORD_RANGEFINDER,
+                RECORD_TYPES
+
+            } recordType_t;
+
+            // Bytes after the type and timestamp, or 0 for an unknown type
+            static uint8_t payloadSize(uint8_t type)
+            {
+                static const uint8_t floats[RECORD_TYPES] = {0, 3, 4, 3, 3, 1, 8, 1, 1};
+
+                return type < RECORD_TYPES ? 4 * floats[type] : 0;
+            }
+
+            static const uint8_t MAX_RECORD_SIZE = 1 + 4 + 4*8;
+
+        private:
+
+            Board * _board = NULL;
+
+            void record(recordType_t type, const float * values)
+            {
+                uint8_t buf[MAX_RECORD_SIZE];
+
+                uint32_t usec = _board->getMicroseconds();
+
+                buf[0] = type;
+                memcpy(&buf[1], &usec, 4);
+                memcpy(&buf[5], values, payloadSize(type));
+
+                write(buf, 5 + payloadSize(type));
+            }
+
+        protected:
+
+            virtual void write(const uint8_t * bytes, uint8_t count) = 0;
+
+        public:
+
+            // Timestamps come from the board's clock
+            void begin(Board * board)
+            {
+                _board = board;
+
+                const uint8_t header[HEADER_SIZE] = {'H', 'F', 'R', VERSION};
+
+                write(header, HEADER_SIZE);
+            }
+
+    }; // class Recorder
+
+    // Records the readings of another IMU, before any mounting adjustment.  A raw recording takes an accelerometer
+    // reading with each gyrometer reading and leaves out the quaternion, for replay through a software estimator.
+    class RecordingIMU : public IMU {
+
+        private:
+
+            IMU * _imu = NULL;
+
+            Recorder * _recorder = NULL;
+
+            bool _raw = false;
+
+        protected:
+
+            virtual bool getQuaternion(float & qw, float & qx, float & qy, float & qz, uint32_t usec) override
+            {
+                if (!_imu->getQuaternion(qw, qx, qy, qz, usec)) {
+                    return false;
+                }
+
+                if (_raw) {
+                    return true;
+                }
+
+                const float values[4] = {qw, qx, qy, qz};
+                _recorder->record(Recorder::RECORD_QUATERNION, values);
+
+                return true;
+            }
+
+            virtual bool getGyrometer(float & gx, float & gy, float & gz) override
+            {
+                if (!_imu->getGyrometer(gx, gy, gz)) {
+                    return false;
+                }
+
+                const float values[3] = {gx, gy, gz};
+                _recorder->record(Recorder::RECORD_GYROMETER, values);
+
+                // Recorded by getAccelerometer() below
+                if (_raw) {
+                    float ax = 0, ay = 0, az = 0;
+                    getAccelerometer(ax, ay, az);
+                }
+
+                return true;
+            }
+
+            virtual void adjustEulerAngles(float & x, float & y, float & z) override
+            {
+                _imu->adjustEulerAngles(x, y, z);
+            }
+
+            virtual void adjustGyrometer(float & x, float & y, float & z) override
+            {
+                _imu->adjustGyrometer(x, y, z);
+            }
+
+            virtual void begin(void) override
+            {
+                _imu->begin();
+            }
+
+            virtual bool getAccelerometer(float & ax, float & ay, float & az) override
+            {
+                if (!_imu->getAccelerometer(ax, ay, az)) {
+                    return false;
+                }
+
+                const float values[3] = {ax, ay, az};
+                _recorder->record(Recorder::RECORD_ACCELEROMETER, values);
+
+                return true;
+            }
+
+            virtual bool getMagnetometer(float & mx, float & my, float & mz) override
+            {
+                if (!_imu->getMagnetometer(mx, my, mz)) {
+                    return false;
+                }
+
+                const float values[3] = {mx, my, mz};
+                _recorder->record(Recorder::RECORD_MAGNETOMETER, values);
+
+                return true;
+            }
+
+            virtual bool getBarometer(float & pressure) override
+            {
+                if (!_imu->getBarometer(pressure)) {
+                    return false;
+                }
+
+                _recorder->record(Recorder::RECORD_BAROMETER, &pressure);
+
+                return true;
+            }
+
+        public:
+
+            RecordingIMU(IMU * imu, Recorder * recorder, bool raw=false)
+            {
+                _imu = imu;
+                _recorder = recorder;
+                _raw = raw;
+            }
+
+    }; // class RecordingIMU
+
+    // Records the raw channel values of each new frame from another receiver, and changes in its signal status
+    class RecordingReceiver : public Receiver {
+
+        private:
+
+            static_assert(MAXCHAN == 8, "RECORD_RECEIVER_FRAME holds eight channels");
+
+            Receiver * _receiver = NULL;
+
+            Recorder * _recorder = NULL;
+
+            bool _lostSignal = false;
+
+        protected:
+
+            virtual void begin(void) override
+            {
+                _receiver->begin();
+            }
+
+            virtual bool gotNewFrame(void) override
+            {
+                return _receiver->gotNewFrame();
+            }
+
+            virtual void readRawvals(void) override
+            {
+                _receiver->readRawvals();
+
+                memcpy(rawvals, _receiver->rawvals, sizeof(rawvals));
+
+                _recorder->record(Recorder::RECORD_RECEIVER_FRAME, rawvals);
+            }
+
+            virtual bool lostSignal(void) override
+            {
+                bool lost = _receiver->lostSignal();
+
+                if (lost != _lostSignal) {
+                    const float value = lost;
+                    _recorder->record(Recorder::RECORD_LOST_SIGNAL, &value);
+                    _lostSignal = lost;
+                }
+
+                return lost;
+            }
+
+        public:
+
+            // Takes its channel map, demand scale, and trim from the wrapped receiver
+            RecordingReceiver(Receiver * receiver, Recorder * recorder)
+                : Receiver(receiver->_channelMap, receiver->_demandScale)
+            {
+                _receiver = receiver;
+                _recorder = recorder;
+
+                _trimRoll  = receiver->_trimRoll;
+                _trimPitch = receiver->_trimPitch;
+                _trimYaw   = receiver->_trimYaw;
+            }
+
+    }; // class RecordingReceiver
+
+    // Records each distance another rangefinder reports
+    class RecordingRangefinder : public Rangefinder {
+
+        private:
+
+            Rangefinder * _rangefinder = NULL;
+
+            Recorder * _recorder = NULL;
+
+        protected:
+
+            virtual bool distanceAvailable(float & distance) override
+            {
+                if (!_rangefinder->distanceAvailable(distance)) {
+                    return false;
+                }
+
+                _recorder->record(Recorder::RECORD_RANGEFINDER, &distance);
+
+                return true;
+            }
+
+        public:
+
+            RecordingRangefinder(Rangefinder * rangefinder, Recorder * recorder)
+            {
+                _rangefinder = rangefinder;
+                _recorder = recorder;
+            }
+
+    }; // class RecordingRangefinder
+
+} // namespace hf
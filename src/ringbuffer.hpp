@@ -0,0 +1,100 @@
+/*
+   Lock-free single-producer / single-consumer ring buffer
+
+   One side (typically an interrupt handler) calls push(); the other side
+   (typically the main loop) calls pop().  Each index is written by only one
+   side and is a single byte, so no lock or interrupt masking is needed.
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace hf {
+
+    template <typename T, uint8_t N>
+    class RingBuffer {
+
+        // Free-running byte indices: the difference is the fill level as long as N fits in 7 bits
+        static_assert(N > 1 && N <= 128 && (N & (N-1)) == 0, "RingBuffer size must be a power of two <= 128");
+
+        private:
+
+            T _items[N];
+
+            // Written only by the producer
+            uint8_t _head = 0;
+            uint32_t _overruns = 0;
+
+            // Written only by the consumer
+            uint8_t _tail = 0;
+
+        public:
+
+            // Producer side; returns false (and counts an overrun) when full
+            bool push(const T & item)
+            {
+                uint8_t head = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+                uint8_t tail = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+
+                if ((uint8_t)(head - tail) == N) {
+                    _overruns++;
+                    return false;
+                }
+
+                _items[head & (N-1)] = item;
+
+                // Publish the item only after it has been written
+                __atomic_store_n(&_head, (uint8_t)(head+1), __ATOMIC_RELEASE);
+
+                return true;
+            }
+
+            // Consumer side; returns false when empty
+            bool pop(T & item)
+            {
+                uint8_t tail = __atomic_load_n(&_tail, __ATOMIC_RELAXED);
+                uint8_t head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+
+                if (head == tail) {
+                    return false;
+                }
+
+                item = _items[tail & (N-1)];
+
+                // Hand the slot back only after the item has been read
+                __atomic_store_n(&_tail, (uint8_t)(tail+1), __ATOMIC_RELEASE);
+
+                return true;
+            }
+
+            uint8_t available(void)
+            {
+                return __atomic_load_n(&_head, __ATOMIC_ACQUIRE) - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+            }
+
+            // Items dropped because the consumer fell behind
+            uint32_t overruns(void)
+            {
+                return _overruns;
+            }
+
+    }; // class RingBuffer
+
+} // namespace hf
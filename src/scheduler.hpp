@@ -0,0 +1,128 @@
+/*
+   Cooperative scheduler for timer tasks
+
+   Each call to run() updates the enabled tasks in priority order, highest
+   first, so when several come due on the same pass the most important one
+   goes first.
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "debugger.hpp"
+#include "timertask.hpp"
+#include "looptimer.hpp"
+
+// Room for the PID and serial tasks and any of your own; define this before including Hackflight if your build adds more
+#ifndef HACKFLIGHT_MAX_TASKS
+#define HACKFLIGHT_MAX_TASKS 8
+#endif
+
+namespace hf {
+
+    class Scheduler {
+
+        friend class Hackflight;
+        friend class SerialTask;
+
+        public:
+
+            static constexpr uint8_t MAX_TASKS = HACKFLIGHT_MAX_TASKS;
+
+        private:
+
+            static_assert(HACKFLIGHT_MAX_TASKS >= 2 && HACKFLIGHT_MAX_TASKS < 255,
+                    "Task count must leave room for the PID and serial tasks and fit in a uint8_t");
+
+            typedef struct {
+
+                TimerTask * task;
+                uint8_t priority;
+                uint8_t stage;  // loop-timing stage, or LoopTimer::STAGE_NONE
+                bool enabled;
+
+            } entry_t;
+
+            entry_t _entries[MAX_TASKS] = {};
+            uint8_t _count = 0;
+
+            // Optional; NULL when another thread owns the loop timer
+            LoopTimer * _loopTimer = NULL;
+
+            void init(LoopTimer * loopTimer)
+            {
+                _loopTimer = loopTimer;
+                _count = 0;
+            }
+
+            bool add(TimerTask * task, uint8_t priority, uint8_t stage=LoopTimer::STAGE_NONE)
+            {
+                if (_count == MAX_TASKS) {
+                    Debugger::printf("Too many tasks; define HACKFLIGHT_MAX_TASKS higher.  Will not arm.\n");
+                    return false;
+                }
+
+                // Insert after tasks of the same or higher priority, so equal priorities run in the order added
+                uint8_t k = _count;
+                while (k > 0 && _entries[k-1].priority < priority) {
+                    _entries[k] = _entries[k-1];
+                    k--;
+                }
+
+                _entries[k].task = task;
+                _entries[k].priority = priority;
+                _entries[k].stage = stage;
+                _entries[k].enabled = true;
+
+                _count++;
+
+                return true;
+            }
+
+            void enable(TimerTask * task, bool enabled)
+            {
+                for (uint8_t k=0; k<_count; ++k) {
+                    if (_entries[k].task == task) {
+                        _entries[k].enabled = enabled;
+                    }
+                }
+            }
+
+            void run(void)
+            {
+                for (uint8_t k=0; k<_count; ++k) {
+
+                    entry_t & entry = _entries[k];
+
+                    if (!entry.enabled) {
+                        continue;
+                    }
+
+                    bool ran = entry.task->update();
+
+                    if (_loopTimer) {
+                        _loopTimer->lap(ran ? entry.stage : (uint8_t)LoopTimer::STAGE_NONE);
+                    }
+                }
+            }
+
+    }; // class Scheduler
+
+} // namespace hf
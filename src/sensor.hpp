@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <stdint.h>
+
 #include "datatypes.hpp"
 
 namespace hf {
@@ -27,12 +29,49 @@ namespace hf {
     class Sensor {
 
         friend class Hackflight;
+        friend class SensorInterrupts;
+
+        private:
+
+            // Interrupt-driven sensors are only checked after their data-ready interrupt fires
+            bool _interruptDriven = false;
+
+            // Set by the interrupt, cleared by the main loop.  A single byte is read and written
+            // atomically on every MCU we support, so no lock is needed.
+            volatile bool _dataReady = false;
+
+            bool checkDataReady(void)
+            {
+                if (!_dataReady) {
+                    return false;
+                }
+
+                // An interrupt arriving after this point sets the flag again for the next pass
+                _dataReady = false;
+
+                return true;
+            }
 
         protected:
 
-            virtual void modifyState(state_t & state, float time) = 0;
+            virtual void modifyState(state_t & state, uint32_t usec) = 0;
+
+            virtual bool ready(uint32_t usec) = 0;
+
+            // Call from begin() or a constructor to switch from polling to interrupt-driven checking; or see
+            // SensorInterrupts::attach(), which also attaches the handler
+            void useDataReadyInterrupt(void)
+            {
+                _interruptDriven = true;
+            }
+
+        public:
 
-            virtual bool ready(float time) = 0;
+            // Safe to call from an interrupt handler (or from a simulated one on the host)
+            void setDataReady(void)
+            {
+                _dataReady = true;
+            }
 
     };  // class Sensor
 
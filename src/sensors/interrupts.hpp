@@ -0,0 +1,107 @@
+/*
+   Routes data-ready interrupts to the sensors that asked for them
+
+   Arduino interrupt handlers take no arguments, so each slot here has its
+   own handler, which finds its sensor in a table indexed by slot.  The table
+   lives in a function-local static of an inline function, so every
+   translation unit shares one copy, and each sensor gets its own slot.
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "sensor.hpp"
+
+namespace hf {
+
+    class SensorInterrupts {
+
+        public:
+
+            static const uint8_t MAX_SLOTS = 4;
+
+        private:
+
+            typedef struct {
+
+                Sensor * sensor;
+                int8_t pin;
+
+            } slot_t;
+
+            static slot_t * slots(void)
+            {
+                static slot_t _slots[MAX_SLOTS] = { {NULL, -1}, {NULL, -1}, {NULL, -1}, {NULL, -1} };
+
+                return _slots;
+            }
+
+            template <uint8_t K>
+            static void handler(void)
+            {
+                slots()[K].sensor->setDataReady();
+            }
+
+            static void (*handlerFor(uint8_t k))(void)
+            {
+                static void (* const HANDLERS[MAX_SLOTS])(void) = { handler<0>, handler<1>, handler<2>, handler<3> };
+
+                return HANDLERS[k];
+            }
+
+        public:
+
+            // Switches the sensor to interrupt-driven checking on the falling edge of the given pin.  A pin
+            // attached again goes to the new sensor.  Returns false, leaving the sensor polled, when every
+            // slot is taken.
+            static bool attach(Sensor * sensor, int8_t pin)
+            {
+                slot_t * table = slots();
+
+                uint8_t k = 0;
+
+                // The pin's own slot if it has one, else the first free one
+                while (k < MAX_SLOTS && table[k].pin != pin) {
+                    ++k;
+                }
+                if (k == MAX_SLOTS) {
+                    k = 0;
+                    while (k < MAX_SLOTS && table[k].pin >= 0) {
+                        ++k;
+                    }
+                }
+                if (k == MAX_SLOTS) {
+                    return false;
+                }
+
+                table[k].sensor = sensor;
+                table[k].pin = pin;
+
+                sensor->useDataReadyInterrupt();
+
+                pinMode(pin, INPUT);
+                attachInterrupt(digitalPinToInterrupt(pin), handlerFor(k), FALLING);
+
+                return true;
+            }
+
+    }; // class SensorInterrupts
+
+} // namespace hf
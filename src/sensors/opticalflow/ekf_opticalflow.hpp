@@ -40,7 +40,7 @@ namespace hf {
 
         private:
 
-            static constexpr float UPDATE_PERIOD = .01f;
+            static constexpr uint32_t UPDATE_PERIOD_USEC = 10000;
             static constexpr float FLOW_SCALE    = 100.f;
 
             // The bounds on the covariance, these shouldn't be hit, but sometimes are... why?
@@ -53,7 +53,7 @@ namespace hf {
             PMW3901 _flowSensor = PMW3901(10);
 
             // Track elapsed time for periodic readiness
-            float _previousTime = 0;
+            uint32_t _previousUsec = 0;
 
             // While tracking elapsed time, store delta time
             float _deltaTime = 0;
@@ -92,6 +92,19 @@ namespace hf {
 
             Matrix Pm = Matrix(STATE_DIM, STATE_DIM);
 
+            // Matrix to rotate the attitude covariances once updated
+            Matrix Am = Matrix(STATE_DIM, STATE_DIM);
+
+            // The Kalman gain as a column vector
+            Matrix Km = Matrix(STATE_DIM, 1);
+
+            // Temporary matrices for the covariance updates
+            Matrix tmpNN1m = Matrix(STATE_DIM, STATE_DIM);
+            Matrix tmpNN2m = Matrix(STATE_DIM, STATE_DIM);
+            Matrix tmpNN3m = Matrix(STATE_DIM, STATE_DIM);
+            Matrix HTm = Matrix(STATE_DIM, 1);
+            Matrix PHTm = Matrix(STATE_DIM, 1);
+
             static constexpr float STDDEV = 0.25f;
 
             // ~~~ Camera constants ~~~
@@ -138,13 +151,6 @@ namespace hf {
 
             void stateEstimatorFinalize(void)
             {
-                // Matrix to rotate the attitude covariances once updated
-                static Matrix Am(STATE_DIM, STATE_DIM);
-
-                // Temporary matrices for the covariance updates
-                static Matrix tmpNN1m(STATE_DIM, STATE_DIM);
-                static Matrix tmpNN2m(STATE_DIM, STATE_DIM);
-
                 // Incorporate the attitude error (Kalman filter state) with the attitude
                 float v0 = S[STATE_D0];
                 float v1 = S[STATE_D1];
@@ -259,16 +265,6 @@ namespace hf {
 
             void stateEstimatorScalarUpdate(Matrix & Hm, float error, float stdMeasNoise, const char * label)
             {
-                // The Kalman gain as a column vector
-                static Matrix Km(STATE_DIM, 1);
-
-                // Temporary matrices for the covariance updates
-                static Matrix tmpNN1m(STATE_DIM, STATE_DIM);
-                static Matrix tmpNN2m(STATE_DIM, STATE_DIM);
-                static Matrix tmpNN3m(STATE_DIM, STATE_DIM);
-                static Matrix HTm(STATE_DIM, 1);
-                static Matrix PHTm(STATE_DIM, 1);
-
                 // ====== INNOVATION COVARIANCE ======
 
                 Matrix::trans(Hm, HTm);
@@ -327,8 +323,10 @@ namespace hf {
 
         protected:
 
-            virtual void modifyState(state_t & state, float time) override
+            virtual void modifyState(state_t & state, uint32_t usec) override
             {
+                (void)usec;
+
                 // Avoid time blips
                 if (_deltaTime > 0.02) return;
 
@@ -384,15 +382,17 @@ namespace hf {
                 state.inertialVel[1] = 0;
             }
 
-            virtual bool ready(float time) override
+            virtual bool ready(uint32_t usec) override
             {
-                _deltaTime = time - _previousTime; 
+                uint32_t elapsed = usec - _previousUsec; 
+
+                _deltaTime = elapsed / 1.e6f;
 
-                bool result = _deltaTime > UPDATE_PERIOD;
+                bool result = elapsed > UPDATE_PERIOD_USEC;
 
                 if (result) {
 
-                    _previousTime = time;
+                    _previousUsec = usec;
                 }
 
                 return result;
@@ -409,7 +409,7 @@ namespace hf {
                     }
                 }
 
-                _previousTime = 0;
+                _previousUsec = 0;
 
             }
 
@@ -35,24 +35,26 @@ namespace hf {
 
         private:
 
-            static constexpr float   UPDATE_PERIOD = .01f;
-            static const     uint8_t LPF_SIZE      = 64;
+            static constexpr uint32_t UPDATE_PERIOD_USEC = 10000;
+            static const     uint8_t  LPF_SIZE           = 64;
 
             // Use digital pin 10 for chip select
             PMW3901 _flowSensor = PMW3901(10);
 
             // Use low-pass filters for smoothing
-            LowPassFilter _lpf_x = LowPassFilter(LPF_SIZE);
-            LowPassFilter _lpf_y = LowPassFilter(LPF_SIZE);
+            LowPassFilter<LPF_SIZE> _lpf_x;
+            LowPassFilter<LPF_SIZE> _lpf_y;
 
             // Track elapsed time for periodic readiness
-            float _previousTime = 0;
+            uint32_t _previousUsec = 0;
             float _deltaTime = 0;
 
         protected:
 
-            virtual void modifyState(state_t & state, float time) override
+            virtual void modifyState(state_t & state, uint32_t usec) override
             {
+                (void)usec;
+
                 // Avoid time blips
                 if (_deltaTime > 0.02) return;
 
@@ -69,15 +71,17 @@ namespace hf {
                 state.location[1] += state.inertialVel[1];
             }
 
-            virtual bool ready(float time) override
+            virtual bool ready(uint32_t usec) override
             {
-                _deltaTime = time - _previousTime; 
+                uint32_t elapsed = usec - _previousUsec; 
+
+                _deltaTime = elapsed / 1.e6f;
 
-                bool result = _deltaTime > UPDATE_PERIOD;
+                bool result = elapsed > UPDATE_PERIOD_USEC;
 
                 if (result) {
 
-                    _previousTime = time;
+                    _previousUsec = usec;
                 }
 
                 return result;
@@ -97,7 +101,7 @@ namespace hf {
                 _lpf_x.init();
                 _lpf_y.init();
 
-                _previousTime = 0;
+                _previousUsec = 0;
 
             }
 
@@ -30,48 +30,51 @@ namespace hf {
 
     class Rangefinder : public Sensor {
 
+        friend class RecordingRangefinder;
+
         private:
 
-            static constexpr float UPDATE_HZ = 25; // XXX should be using interrupt!
+            static constexpr uint32_t UPDATE_HZ = 25; // XXX should be using interrupt!
 
-            static constexpr float UPDATE_PERIOD = 1/UPDATE_HZ;
+            static constexpr uint32_t UPDATE_PERIOD_USEC = 1000000 / UPDATE_HZ;
 
             float _distance = 0;
 
-            LowPassFilter _lpf = LowPassFilter(20);
+            LowPassFilter<20> _lpf;
+
+            // Previous values to support first-differencing
+            uint32_t _usec = 0;
+            float _altitude = 0;
+
+            // Time of last accepted reading
+            uint32_t _readyUsec = 0;
 
         protected:
 
-            virtual void modifyState(state_t & state, float time) override
+            virtual void modifyState(state_t & state, uint32_t usec) override
             {
-                // Previous values to support first-differencing
-                static float _time;
-                static float _altitude;
-
                 // Compensate for effect of pitch, roll on rangefinder reading
                 state.location[2] =  _distance * cos(state.rotation[0]) * cos(state.rotation[1]);
 
                 // Use first-differenced, low-pass-filtered altitude as variometer
-                state.inertialVel[2] = _lpf.update((state.location[2]-_altitude) / (time-_time));
+                state.inertialVel[2] = _lpf.update((state.location[2]-_altitude) / ((usec-_usec) / 1.e6f));
 
                 // Update first-difference values
-                _time = time;
+                _usec = usec;
                 _altitude = state.location[2];
             }
 
-            virtual bool ready(float time) override
+            virtual bool ready(uint32_t usec) override
             {
                 float newDistance;
 
                 if (distanceAvailable(newDistance)) {
 
-                    static float _time;
-
-                    if (time-_time > UPDATE_PERIOD) {
+                    if (usec-_readyUsec > UPDATE_PERIOD_USEC) {
 
                         _distance = newDistance;
 
-                        _time = time; 
+                        _readyUsec = usec; 
 
                         return true;
                     }
@@ -20,8 +20,10 @@
 
 #pragma once
 
+#include <Arduino.h>
 #include <VL53L1X.h>
 #include "sensors/rangefinder.hpp"
+#include "sensors/interrupts.hpp"
 
 namespace hf {
 
@@ -44,9 +46,13 @@ namespace hf {
 
         public:
 
-            void begin(void)
+            // Pass the pin wired to the sensor's GPIO1 to read only when the sensor signals new data.  Returns
+            // false if every SensorInterrupts slot is taken, in which case the sensor is polled instead.
+            bool begin(int8_t interruptPin=-1)
             {
                 _distanceSensor.begin();
+
+                return interruptPin < 0 || SensorInterrupts::attach(this, interruptPin);
             }
 
     }; // class VL53L1X_Rangefinder 
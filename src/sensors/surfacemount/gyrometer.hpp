@@ -23,6 +23,7 @@
 #include <math.h>
 
 #include "sensors/surfacemount.hpp"
+#include "gyrofilter.hpp"
 
 namespace hf {
 
@@ -36,11 +37,14 @@ namespace hf {
             float _y = 0;
             float _z = 0;
 
+            // Optional prefilter, run on each raw sample
+            GyroFilter * _filter = NULL;
+
         protected:
 
-            virtual void modifyState(state_t & state, float time) override
+            virtual void modifyState(state_t & state, uint32_t usec) override
             {
-                (void)time;
+                (void)usec;
 
                 // Compensate for IMU mounting as needed
                 imu->adjustGyrometer(_x, _y, _z);
@@ -51,12 +55,24 @@ namespace hf {
                 state.angularVel[2] = -_z;
             }
 
-            virtual bool ready(float time) override
+            virtual bool ready(uint32_t usec) override
             {
-                (void)time;
+                (void)usec;
 
                 bool result = imu->getGyrometer(_x, _y, _z);
 
+                if (result && _filter) {
+
+                    float values[3] = {_x, _y, _z};
+
+                    // A decimating filter drops samples, which then don't update the state
+                    result = _filter->apply(values);
+
+                    _x = values[0];
+                    _y = values[1];
+                    _z = values[2];
+                }
+
                 return result;
             }
 
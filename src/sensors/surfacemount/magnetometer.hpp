@@ -42,16 +42,16 @@ namespace hf {
 
         protected:
 
-            virtual void modifyState(state_t & state, float time) override
+            virtual void modifyState(state_t & state, uint32_t usec) override
             {
                 // Here is where you'd do sensor fusion
                 (void)state;
-                (void)time;
+                (void)usec;
             }
 
-            virtual bool ready(float time) override
+            virtual bool ready(uint32_t usec) override
             {
-                (void)time;
+                (void)usec;
 
                 return imu->getMagnetometer(_uTs);
             }
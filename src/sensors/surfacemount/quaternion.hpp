@@ -27,6 +27,7 @@
 
 #include <math.h>
 
+#include "fastmath.hpp"
 #include "sensors/surfacemount.hpp"
 
 namespace hf {
@@ -52,9 +53,9 @@ namespace hf {
                 _z = 0;
             }
 
-            virtual void modifyState(state_t & state, float time) override
+            virtual void modifyState(state_t & state, uint32_t usec) override
             {
-                (void)time;
+                (void)usec;
 
                 computeEulerAngles(_w, _x, _y, _z, state.rotation);
 
@@ -66,9 +67,9 @@ namespace hf {
                 imu->adjustEulerAngles(state.rotation[0], state.rotation[1], state.rotation[2]);
             }
 
-            virtual bool ready(float time) override
+            virtual bool ready(uint32_t usec) override
             {
-                return imu->getQuaternion(_w, _x, _y, _z, time);
+                return imu->getQuaternion(_w, _x, _y, _z, usec);
             }
 
         public:
@@ -76,9 +77,9 @@ namespace hf {
             // We make this public so we can use it in different sketches
             static void computeEulerAngles(float qw, float qx, float qy, float qz, float euler[3])
             {
-                euler[0] = atan2(2.0f*(qw*qx+qy*qz),qw*qw-qx*qx-qy*qy+qz*qz);
-                euler[1] =  asin(2.0f*(qx*qz-qw*qy));
-                euler[2] = atan2(2.0f*(qx*qy+qw*qz),qw*qw+qx*qx-qy*qy-qz*qz);
+                euler[0] = FastMath::atan2(2.0f*(qw*qx+qy*qz),qw*qw-qx*qx-qy*qy+qz*qz);
+                euler[1] =  FastMath::asin(2.0f*(qx*qz-qw*qy));
+                euler[2] = FastMath::atan2(2.0f*(qx*qy+qw*qz),qw*qw+qx*qx-qy*qy-qz*qz);
             }
 
     };  // class Quaternion
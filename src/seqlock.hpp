@@ -0,0 +1,87 @@
+/*
+   Sequence lock for passing a snapshot from one core (or thread) to another
+
+   The writer never waits.  A reader copies the data and retries if the writer
+   was in the middle of an update, so neither side ever blocks on the other.
+   There must be only one writer per Seqlock.
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace hf {
+
+    template <typename T>
+    class Seqlock {
+
+        private:
+
+            // Odd while a write is in progress
+            uint32_t _seq = 0;
+
+            T _data = T();
+
+        public:
+
+            void write(const T & data)
+            {
+                uint32_t seq = __atomic_load_n(&_seq, __ATOMIC_RELAXED);
+
+                __atomic_store_n(&_seq, seq+1, __ATOMIC_RELAXED);
+                __atomic_thread_fence(__ATOMIC_RELEASE);
+
+                _data = data;
+
+                __atomic_store_n(&_seq, seq+2, __ATOMIC_RELEASE);
+            }
+
+            // Returns false, leaving data as it was, if a write got in the way; the caller can try again or
+            // keep its old copy
+            bool tryRead(T & data)
+            {
+                uint32_t seq = __atomic_load_n(&_seq, __ATOMIC_ACQUIRE);
+
+                if (seq & 1) {
+                    return false;
+                }
+
+                // Copied aside, as it may be torn until we've checked the sequence number
+                T copy = _data;
+
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+                if (__atomic_load_n(&_seq, __ATOMIC_RELAXED) != seq) {
+                    return false;
+                }
+
+                data = copy;
+
+                return true;
+            }
+
+            void read(T & data)
+            {
+                while (!tryRead(data))
+                    ;
+            }
+
+    }; // class Seqlock
+
+} // namespace hf
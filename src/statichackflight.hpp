@@ -0,0 +1,391 @@
+/*
+   Hackflight core algorithm, with components composed at compile time
+
+   Hackflight uses virtual methods for the board, IMU, receiver, mixer, motors,
+   and PID controllers, so that a sketch can mix and match them at run time.
+   StaticHackflight takes the same classes as template parameters and holds them
+   by value, so the compiler can inline the entire gyro => PID => mixer => motor
+   chain.  It covers the flight-critical loop only: there is no MSP/GCS support
+   and no optional sensors.  Use Hackflight for those.
+
+   Copyright (c) 2020 Simon D. Levy
+
+   This file is part of Hackflight.
+
+   Hackflight is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Hackflight is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with Hackflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string.h>
+
+#include "imu.hpp"
+#include "board.hpp"
+#include "motor.hpp"
+#include "receiver.hpp"
+#include "datatypes.hpp"
+#include "pidcontroller.hpp"
+#include "actuators/mixer.hpp"
+#include "sensors/surfacemount/quaternion.hpp"
+
+namespace hf {
+
+    // Compile-time list of PID controllers, run in the order given
+    template <typename... Controllers>
+    class StaticPidControllers {
+
+        public:
+
+            void run(state_t * state, demands_t & demands, uint32_t usec, uint8_t auxState, bool throttleIsDown,
+                    bool & shouldFlash)
+            {
+                (void)state;
+                (void)demands;
+                (void)usec;
+                (void)auxState;
+                (void)throttleIsDown;
+                (void)shouldFlash;
+            }
+
+            void setAuxState(uint8_t index, uint8_t auxState)
+            {
+                (void)index;
+                (void)auxState;
+            }
+
+    }; // class StaticPidControllers
+
+    template <typename Controller, typename... Controllers>
+    class StaticPidControllers<Controller, Controllers...> {
+
+        private:
+
+            Controller _controller;
+
+            StaticPidControllers<Controllers...> _rest;
+
+        public:
+
+            StaticPidControllers(const Controller & controller, const Controllers & ... controllers)
+                : _controller(controller), _rest(controllers...)
+            {
+            }
+
+            void run(state_t * state, demands_t & demands, uint32_t usec, uint8_t auxState, bool throttleIsDown,
+                    bool & shouldFlash)
+            {
+                // Calls via the base class, but on an object of known type, so the compiler can inline them
+                PidController & pidController = _controller;
+
+                // Some PID controllers need to reset their integral when the throttle is down
+                pidController.updateReceiver(throttleIsDown);
+
+                if (pidController.auxState <= auxState) {
+
+                    pidController.run(state, demands, usec);
+
+                    if (pidController.shouldFlashLed()) {
+                        shouldFlash = true;
+                    }
+                }
+
+                else {
+                    pidController.stop();
+                }
+
+                _rest.run(state, demands, usec, auxState, throttleIsDown, shouldFlash);
+            }
+
+            void setAuxState(uint8_t index, uint8_t auxState)
+            {
+                if (index == 0) {
+                    static_cast<PidController &>(_controller).auxState = auxState;
+                }
+                else {
+                    _rest.setAuxState(index-1, auxState);
+                }
+            }
+
+    }; // class StaticPidControllers
+
+    template <typename BoardT, typename ImuT, typename ReceiverT, typename MixerT, typename MotorT,
+             typename... Controllers>
+    class StaticHackflight {
+
+        private:
+
+            static constexpr float MAX_ARMING_ANGLE_DEGREES = 25.0f;
+
+            // Same base rate as PidTask
+            static constexpr uint32_t PID_PERIOD_USEC = 1000000 / 300;
+
+            // Board is passed to init(), because most boards start their hardware in their constructor
+            BoardT * _board = NULL;
+
+            // Everything else is held by value, so calls on it need no virtual dispatch
+            ImuT      _imu;
+            ReceiverT _receiver;
+            MixerT    _mixer;
+            MotorT    _motors;
+
+            StaticPidControllers<Controllers...> _pidControllers;
+
+            // Vehicle state
+            state_t _state;
+
+            // Safety
+            bool _safeToArm = false;
+
+            // Support for headless mode
+            float _yawInitial = 0;
+
+            // Support for PID timing
+            bool _gyroSync = false;
+            uint32_t _pidDeadline = 0;
+
+            // Avoids sending the motors the same value over and over
+            float _motorsPrev[Mixer::MAXMOTORS] = {0};
+
+            uint32_t getMicroseconds(void)
+            {
+                // Qualified call bypasses virtual dispatch
+                return _board->BoardT::getMicroseconds();
+            }
+
+            IMU & imu(void)
+            {
+                return _imu;
+            }
+
+            Receiver & receiver(void)
+            {
+                return _receiver;
+            }
+
+            Mixer & mixer(void)
+            {
+                return _mixer;
+            }
+
+            bool safeAngle(uint8_t axis)
+            {
+                return fabs(_state.rotation[axis]) < Filter::deg2rad(MAX_ARMING_ANGLE_DEGREES);
+            }
+
+            void cutMotors(void)
+            {
+                for (uint8_t i = 0; i < mixer()._nmotors; i++) {
+                    static_cast<Motor &>(_motors).write(i, 0);
+                    _motorsPrev[i] = 0;
+                }
+            }
+
+            void runMotors(demands_t & demands)
+            {
+                float motorvals[Mixer::MAXMOTORS];
+
+                mixer().mix(demands, motorvals);
+
+                for (uint8_t i = 0; i < mixer()._nmotors; i++) {
+                    if (_motorsPrev[i] != motorvals[i]) {
+                        static_cast<Motor &>(_motors).write(i, motorvals[i]);
+                    }
+                    _motorsPrev[i] = motorvals[i];
+                }
+            }
+
+            void checkReceiver(void)
+            {
+                Receiver & rx = receiver();
+
+                // Sync failsafe to receiver
+                if (rx.lostSignal() && _state.armed) {
+                    cutMotors();
+                    _state.armed = false;
+                    _state.failsafe = true;
+                    _board->BoardT::showArmedStatus(false);
+                    return;
+                }
+
+                // Check whether receiver data is available
+                if (!rx.getDemands(_state.rotation[AXIS_YAW] - _yawInitial)) return;
+
+                // Disarm
+                if (_state.armed && !rx.getAux1State()) {
+                    _state.armed = false;
+                }
+
+                // Avoid arming if aux1 switch down on startup
+                if (!_safeToArm) {
+                    _safeToArm = !rx.getAux1State();
+                }
+
+                // Arm (after lots of safety checks!)
+                if (_safeToArm && !_state.armed && rx.throttleIsDown() && rx.getAux1State() &&
+                        !_state.failsafe && safeAngle(AXIS_ROLL) && safeAngle(AXIS_PITCH)) {
+                    _state.armed = true;
+                    _yawInitial = _state.rotation[AXIS_YAW]; // grab yaw for headless mode
+                }
+
+                // Cut motors on throttle-down
+                if (_state.armed && rx.throttleIsDown()) {
+                    cutMotors();
+                }
+
+                // Set LED based on arming status
+                _board->BoardT::showArmedStatus(_state.armed);
+            }
+
+            void runPidControllers(uint32_t usec)
+            {
+                Receiver & rx = receiver();
+
+                // Start with demands from receiver, scaling roll/pitch/yaw by constant
+                demands_t demands = {};
+                demands.throttle = rx.demands.throttle;
+                demands.roll     = rx.demands.roll  * rx._demandScale;
+                demands.pitch    = rx.demands.pitch * rx._demandScale;
+                demands.yaw      = rx.demands.yaw   * rx._demandScale;
+
+                bool throttleIsDown = rx.throttleIsDown();
+
+                // Some PID controllers should cause LED to flash when they're active
+                bool shouldFlash = false;
+
+                _pidControllers.run(&_state, demands, usec, rx.getAux2State(), throttleIsDown, shouldFlash);
+
+                _board->BoardT::flashLed(shouldFlash);
+
+                // Use updated demands to run motors
+                if (_state.armed && !_state.failsafe && !throttleIsDown) {
+                    runMotors(demands);
+                }
+            }
+
+            bool checkGyrometer(void)
+            {
+                float x = 0, y = 0, z = 0;
+
+                if (!imu().getGyrometer(x, y, z)) {
+                    return false;
+                }
+
+                // Compensate for IMU mounting as needed
+                imu().adjustGyrometer(x, y, z);
+
+                // NB: We negate gyro X, Y to simplify PID controller
+                _state.angularVel[0] =  x;
+                _state.angularVel[1] = -y;
+                _state.angularVel[2] = -z;
+
+                return true;
+            }
+
+            void checkQuaternion(uint32_t usec)
+            {
+                float qw = 0, qx = 0, qy = 0, qz = 0;
+
+                if (!imu().getQuaternion(qw, qx, qy, qz, usec)) {
+                    return;
+                }
+
+                Quaternion::computeEulerAngles(qw, qx, qy, qz, _state.rotation);
+
+                // Convert heading from [-pi,+pi] to [0,2*pi]
+                if (_state.rotation[2] < 0) {
+                    _state.rotation[2] += 2*M_PI;
+                }
+
+                imu().adjustEulerAngles(_state.rotation[0], _state.rotation[1], _state.rotation[2]);
+            }
+
+        public:
+
+            StaticHackflight(const ImuT & imu, const ReceiverT & receiver, const MixerT & mixer, const MotorT & motors,
+                    const Controllers & ... controllers)
+                : _imu(imu), _receiver(receiver), _mixer(mixer), _motors(motors), _pidControllers(controllers...)
+            {
+            }
+
+            void init(BoardT * board, bool armed=false)
+            {
+                _board = board;
+
+                // Initialize state
+                memset(&_state, 0, sizeof(state_t));
+
+                // Support safety override by simulator
+                _state.armed = armed;
+
+                // Initialize the receiver
+                receiver().begin();
+
+                // Start the IMU
+                imu().begin();
+
+                // Tell the mixer which motors to use, and initialize them
+                mixer().useMotors(&_motors);
+            }
+
+            // PID controllers are numbered in the order they appear in the template parameters
+            void setAuxState(uint8_t pidControllerIndex, uint8_t auxState)
+            {
+                _pidControllers.setAuxState(pidControllerIndex, auxState);
+            }
+
+            // See Hackflight::setGyroSync()
+            void setGyroSync(bool gyroSync)
+            {
+                _gyroSync = gyroSync;
+            }
+
+            void update(void)
+            {
+                // Grab control signal if available
+                checkReceiver();
+
+                uint32_t usec = getMicroseconds();
+
+                // Run PID controllers on a new gyro sample, or on their own timer
+                bool gotGyro = checkGyrometer();
+                if (_gyroSync ? gotGyro : (int32_t)(usec - _pidDeadline) >= 0) {
+                    runPidControllers(usec);
+                    // Absolute deadlines, like TimerTask, skipping any runs we missed entirely
+                    _pidDeadline += PID_PERIOD_USEC;
+                    if ((int32_t)(usec - _pidDeadline) >= 0) {
+                        _pidDeadline = usec + PID_PERIOD_USEC - (usec - _pidDeadline) % PID_PERIOD_USEC;
+                    }
+                }
+
+                checkQuaternion(usec);
+            }
+
+            // Access to the components, e.g. for feeding receiver bytes from a serial interrupt
+            ImuT & getImu(void)
+            {
+                return _imu;
+            }
+
+            ReceiverT & getReceiver(void)
+            {
+                return _receiver;
+            }
+
+            MotorT & getMotors(void)
+            {
+                return _motors;
+            }
+
+    }; // class StaticHackflight
+
+} // namespace hf
@@ -27,10 +27,67 @@ namespace hf {
 
     class TimerTask {
 
+        friend class Hackflight;
+        friend class Scheduler;
+        friend class SerialTask;
+
+        public:
+
+            // What to do after falling a whole period or more behind schedule
+            typedef enum {
+
+                CATCHUP_SKIP,  // drop the missed runs, keeping to the original schedule
+                CATCHUP_BURST  // make up the missed runs on the following updates
+
+            } catchup_t;
+
         private:
 
-            float _period = 0;
-            float _time = 0;
+            // Microseconds
+            uint32_t _period = 0;
+
+            // Absolute time of the next run, so a late run doesn't push back the ones after it
+            uint32_t _deadline = 0;
+            bool _started = false;
+
+            catchup_t _catchup = CATCHUP_SKIP;
+
+            // Statistics, reported over MSP
+            uint32_t _count = 0;
+            uint32_t _overruns = 0;  // runs that started a whole period or more late
+            uint32_t _skipped = 0;   // runs dropped by CATCHUP_SKIP
+            uint32_t _lastUsec = 0;
+            uint64_t _elapsedUsec = 0; // from first run to last; the microsecond counter wraps every 71.6 minutes
+            uint32_t _jitterMax = 0; // lateness of start time, usec
+            uint64_t _jitterSum = 0;
+
+            void record(uint32_t usec, uint32_t late)
+            {
+                // Each step is far short of a wrap, so the unsigned difference is right even across one
+                if (_count > 0) {
+                    _elapsedUsec += (uint32_t)(usec - _lastUsec);
+                }
+
+                _lastUsec = usec;
+                _count++;
+
+                if (late > _jitterMax) {
+                    _jitterMax = late;
+                }
+
+                _jitterSum += late;
+            }
+
+            // Achieved rate, over all runs so far
+            float rate(void)
+            {
+                return _elapsedUsec ? (float)((_count - 1) * 1.e6 / _elapsedUsec) : 0;
+            }
+
+            uint32_t meanJitter(void)
+            {
+                return _count ? (uint32_t)(_jitterSum / _count) : 0;
+            }
 
         protected:
 
@@ -38,8 +95,7 @@ namespace hf {
 
             TimerTask(float freq)
             {
-                _period = 1 / freq;
-                _time = 0;
+                _period = (uint32_t)(1.e6f / freq);
             }
 
             void init(Board * board)
@@ -51,15 +107,47 @@ namespace hf {
 
         public:
 
-            void update(void)
+            void setCatchup(catchup_t catchup)
             {
-                float time = _board->getTime();
+                _catchup = catchup;
+            }
+
+            // Returns true if the task ran
+            bool update(void)
+            {
+                uint32_t usec = _board->getMicroseconds();
+
+                // First update runs right away and sets the schedule
+                if (!_started) {
+                    _deadline = usec;
+                    _started = true;
+                }
 
-                if ((time - _time) > _period)
-                {
-                    doTask();
-                    _time = time;
+                // Signed difference stays correct when the microsecond counter wraps
+                if ((int32_t)(usec - _deadline) < 0) {
+                    return false;
                 }
+
+                uint32_t late = usec - _deadline;
+
+                doTask();
+
+                record(usec, late);
+
+                _deadline += _period;
+
+                if (late >= _period) {
+
+                    _overruns++;
+
+                    if (_catchup == CATCHUP_SKIP) {
+                        uint32_t missed = late / _period;
+                        _skipped += missed;
+                        _deadline += missed * _period;
+                    }
+                }
+
+                return true;
             }
 
     };  // TimerTask
@@ -21,6 +21,12 @@
 #pragma once
 
 #include "timertask.hpp"
+#include "debugger.hpp"
+
+// Room for PID controllers; define this before including Hackflight if your build adds more
+#ifndef HACKFLIGHT_MAX_PID_CONTROLLERS
+#define HACKFLIGHT_MAX_PID_CONTROLLERS 8
+#endif
 
 namespace hf {
 
@@ -28,16 +34,34 @@ namespace hf {
 
         friend class Hackflight;
 
+        public:
+
+            static constexpr uint8_t MAX_PID_CONTROLLERS = HACKFLIGHT_MAX_PID_CONTROLLERS;
+
         private:
 
-            // For now, we keep all PID timer tasks the same.  At some point it might be useful to 
-            // investigate, e.g., faster updates for Rate PID than for Level PID.
+            // Base rate for PID controllers; slower controllers (e.g., altitude hold) declare their own
+            // rate and hold their demands between updates.  In gyro-sync mode we run at the gyro rate instead.
             static constexpr float FREQ = 300;
 
+            static_assert(HACKFLIGHT_MAX_PID_CONTROLLERS < 255, "PID controller count must fit in a uint8_t");
+
             // PID controllers
-            PidController * _pid_controllers[256] = {NULL};
+            PidController * _pid_controllers[MAX_PID_CONTROLLERS] = {NULL};
             uint8_t _pid_controller_count = 0;
 
+            // What the PID controllers need from the receiver
+            typedef struct {
+
+                demands_t demands;
+                uint8_t   auxState;
+                bool      throttleIsDown;
+
+            } command_t;
+
+            // In dual-core mode, the receiver is read on the other core and we get a snapshot here instead
+            const command_t * _snapshot = NULL;
+
             // Other stuff we need
             Receiver * _receiver = NULL;
             Actuator * _actuator = NULL;
@@ -60,52 +84,83 @@ namespace hf {
                 _state = state;
             }
 
-            void addPidController(PidController * pidController, uint8_t auxState) 
+            bool addPidController(PidController * pidController, uint8_t auxState) 
             {
+                if (_pid_controller_count == MAX_PID_CONTROLLERS) {
+                    Debugger::printf("Too many PID controllers; define HACKFLIGHT_MAX_PID_CONTROLLERS higher.  Will not arm.\n");
+                    return false;
+                }
+
                 pidController->auxState = auxState;
 
                 _pid_controllers[_pid_controller_count++] = pidController;
+
+                return true;
             }
 
-            virtual void doTask(void) override
+            void readReceiver(command_t & command)
             {
                 // Start with demands from receiver, scaling roll/pitch/yaw by constant
-                demands_t demands = {};
-                demands.throttle = _receiver->demands.throttle;
-                demands.roll     = _receiver->demands.roll  * _receiver->_demandScale;
-                demands.pitch    = _receiver->demands.pitch * _receiver->_demandScale;
-                demands.yaw      = _receiver->demands.yaw   * _receiver->_demandScale;
+                command.demands.throttle = _receiver->demands.throttle;
+                command.demands.roll     = _receiver->demands.roll  * _receiver->_demandScale;
+                command.demands.pitch    = _receiver->demands.pitch * _receiver->_demandScale;
+                command.demands.yaw      = _receiver->demands.yaw   * _receiver->_demandScale;
 
                 // Each PID controllers is associated with at least one auxiliary switch state
-                uint8_t auxState = _receiver->getAux2State();
+                command.auxState = _receiver->getAux2State();
+
+                command.throttleIsDown = _receiver->throttleIsDown();
+            }
+
+            virtual void doTask(void) override
+            {
+                command_t command = {};
+
+                if (_snapshot) {
+                    command = *_snapshot;
+                }
+                else {
+                    readReceiver(command);
+                }
+
+                demands_t demands = command.demands;
+
+                uint8_t auxState = command.auxState;
 
                 //Debugger::printf("Aux state: %d", auxState);
 
                 // Some PID controllers should cause LED to flash when they're active
                 bool shouldFlash = false;
 
+                // Supports PID controllers running at different rates
+                uint32_t usec = _board->getMicroseconds();
+
                 for (uint8_t k=0; k<_pid_controller_count; ++k) {
 
                     PidController * pidController = _pid_controllers[k];
 
                     // Some PID controllers need to reset their integral when the throttle is down
-                    pidController->updateReceiver(_receiver->throttleIsDown());
+                    pidController->updateReceiver(command.throttleIsDown);
 
                     if (pidController->auxState <= auxState) {
 
-                        pidController->modifyDemands(_state, demands); 
+                        pidController->run(_state, demands, usec); 
 
                         if (pidController->shouldFlashLed()) {
                             shouldFlash = true;
                         }
                     }
+
+                    else {
+                        pidController->stop();
+                    }
                 }
 
                 // Flash LED for certain PID controllers
                 _board->flashLed(shouldFlash);
 
                 // Use updated demands to run motors
-                if (_state->armed && !_state->failsafe && !_receiver->throttleIsDown()) {
+                if (_state->armed && !_state->failsafe && !command.throttleIsDown) {
                     _actuator->run(demands);
                 }
              }
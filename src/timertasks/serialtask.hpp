@@ -24,6 +24,9 @@
 #include "board.hpp"
 #include "mspparser.hpp"
 #include "debugger.hpp"
+#include "looptimer.hpp"
+#include "seqlock.hpp"
+#include "scheduler.hpp"
 #include "actuators/mixer.hpp"
 
 namespace hf {
@@ -36,9 +39,33 @@ namespace hf {
 
             static constexpr float FREQ = 66;
 
-            Mixer    * _mixer = NULL;
-            Receiver * _receiver = NULL;
-            state_t  * _state = NULL;
+        public:
+
+            // Motors that SET_MOTOR_NORMAL sets
+            static const uint8_t MSP_MOTORS = 4;
+
+        private:
+
+            Mixer     * _mixer = NULL;
+            Receiver  * _receiver = NULL;
+            state_t   * _state = NULL;
+            LoopTimer * _loopTimer = NULL;
+            Scheduler * _scheduler = NULL;
+
+            // Loop stage reported by LOOP_TIMING
+            uint8_t _loopTimingStage = 0;
+
+            // In dual-core mode the loop timer belongs to the other core, which publishes that stage here
+            Seqlock<LoopTimer::stageSnapshot_t> * _loopTimingSnapshot = NULL;
+
+            // Scheduler task reported by TASK_TIMING
+            uint8_t _taskTimingIndex = 0;
+
+            // In dual-core mode the motors belong to the other core, which runs them instead
+            bool _runDisarmedMotors = true;
+
+            // Where SET_MOTOR_NORMAL puts its values: the mixer's, or in dual-core mode a copy for the other core
+            float * _motorsDisarmed = NULL;
 
         protected:
 
@@ -56,7 +83,7 @@ namespace hf {
                 }
 
                 // Support motor testing from GCS
-                if (!_state->armed) {
+                if (!_state->armed && _runDisarmedMotors) {
                     _mixer->runDisarmed();
                 }
             }
@@ -107,10 +134,89 @@ namespace hf {
 
             virtual void handle_SET_MOTOR_NORMAL(float  m1, float  m2, float  m3, float  m4) override
             {
-                _mixer->motorsDisarmed[0] = m1;
-                _mixer->motorsDisarmed[1] = m2;
-                _mixer->motorsDisarmed[2] = m3;
-                _mixer->motorsDisarmed[3] = m4;
+                _motorsDisarmed[0] = m1;
+                _motorsDisarmed[1] = m2;
+                _motorsDisarmed[2] = m3;
+                _motorsDisarmed[3] = m4;
+            }
+
+            virtual void handle_SET_LOOP_TIMING_STAGE(uint8_t  stage) override
+            {
+                _loopTimingStage = stage;
+            }
+
+            virtual void handle_LOOP_TIMING_Request(int32_t & stage, int32_t & stageCount, int32_t & count, 
+                    int32_t & minUsec, int32_t & maxUsec, int32_t & meanUsec, 
+                    int32_t & b0, int32_t & b1, int32_t & b2, int32_t & b3, int32_t & b4, int32_t & b5, 
+                    int32_t & b6, int32_t & b7, int32_t & b8, int32_t & b9, int32_t & b10, int32_t & b11) override
+            {
+                LoopTimer::stageSnapshot_t snapshot = {};
+
+                if (_loopTimingSnapshot) {
+                    _loopTimingSnapshot->read(snapshot);
+                }
+                else {
+                    _loopTimer->snapshot(_loopTimingStage, snapshot);
+                }
+
+                // In dual-core mode, a stage just set may take a few loops to come back
+                stage = snapshot.stage;
+                stageCount = snapshot.stageCount;
+
+                // Out-of-range stage gets zero counts, so GCS can stop at stageCount
+                if (snapshot.stage >= snapshot.stageCount) {
+                    return;
+                }
+
+                StageTimer & timer = snapshot.timer;
+
+                count    = timer._count;
+                minUsec  = timer._min;
+                maxUsec  = timer._max;
+                meanUsec = timer.mean();
+
+                b0  = timer._buckets[0];
+                b1  = timer._buckets[1];
+                b2  = timer._buckets[2];
+                b3  = timer._buckets[3];
+                b4  = timer._buckets[4];
+                b5  = timer._buckets[5];
+                b6  = timer._buckets[6];
+                b7  = timer._buckets[7];
+                b8  = timer._buckets[8];
+                b9  = timer._buckets[9];
+                b10 = timer._buckets[10];
+                b11 = timer._buckets[11];
+            }
+
+            virtual void handle_SET_TASK_TIMING_INDEX(uint8_t  index) override
+            {
+                _taskTimingIndex = index;
+            }
+
+            virtual void handle_TASK_TIMING_Request(int32_t & index, int32_t & taskCount, int32_t & priority, 
+                    int32_t & count, int32_t & overruns, int32_t & skipped, int32_t & rateMilliHz, 
+                    int32_t & meanJitterUsec, int32_t & maxJitterUsec) override
+            {
+                index = _taskTimingIndex;
+                taskCount = _scheduler->_count;
+
+                // Out-of-range index gets zero counts, so GCS can stop at taskCount
+                if (_taskTimingIndex >= _scheduler->_count) {
+                    return;
+                }
+
+                Scheduler::entry_t & entry = _scheduler->_entries[_taskTimingIndex];
+
+                TimerTask * task = entry.task;
+
+                priority       = entry.priority;
+                count          = task->_count;
+                overruns       = task->_overruns;
+                skipped        = task->_skipped;
+                rateMilliHz    = (int32_t)(1000 * task->rate());
+                meanJitterUsec = task->meanJitter();
+                maxJitterUsec  = task->_jitterMax;
             }
 
             SerialTask(void)
@@ -118,7 +224,8 @@ namespace hf {
             {
             }
 
-            void init(Board * board, state_t * state, Mixer * mixer, Receiver * receiver) 
+            void init(Board * board, state_t * state, Mixer * mixer, Receiver * receiver, LoopTimer * loopTimer,
+                    Scheduler * scheduler) 
             {
                 TimerTask::init(board);
 
@@ -126,7 +233,10 @@ namespace hf {
 
                 _state = state;
                 _mixer = mixer;
+                _motorsDisarmed = mixer->motorsDisarmed;
                 _receiver = receiver;
+                _loopTimer = loopTimer;
+                _scheduler = scheduler;
             }
 
     };  // SerialTask